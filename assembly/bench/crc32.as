@@ -0,0 +1,121 @@
+; ==============================================================================
+; Benchmark: CRC32
+;   Computes a bitwise CRC-32/MPEG-2 over a 4 KiB buffer several times
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   report, stdlib
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+entry main
+
+
+; IMPORTS ======================================================================
+
+; report -------------------------------
+extern print_result
+
+
+; stdlib -------------------------------
+extern salloc
+extern sfree
+
+
+; TEXT =========================================================================
+
+section .text
+
+main:
+    push lp
+    push r4
+    push r5
+    push r6
+
+    mov r0, #4096
+    bwl salloc          ; buf = salloc(4096)
+    mov r4, r0
+
+    mov r6, #4096       ; size = 4096
+    mov r3, #0          ; i = 0
+    mov r12, #3         ; value = 3
+    crc_fill:
+    strb r12, r4, r3    ; buf[i] = value
+    add r12, r12, #7    ; value += 7
+    add r3, r3, #1
+    cmp r3, r6
+    blt crc_fill        ; while (++i < size)
+
+    mvn r5, #0          ; crc = 0xFFFFFFFF
+    mov r6, #8          ; passes = 8
+    crc_pass:
+    mov r0, r4
+    mov r1, #4096
+    mov r2, r5
+    bwl crc32
+    mov r5, r0          ; crc = crc32(buf, 4096, crc)
+    sub.s r6, r6, #1
+    bgt crc_pass        ; while (--passes > 0)
+
+    mov r0, _crc
+    mov r1, r5
+    mov r2, #16
+    bwl print_result    ; print_result(_crc, crc, #16)
+
+    bwl sfree           ; sfree(buf)
+
+    pop r6
+    pop r5
+    pop r4
+    pop lp
+    mov r0, #0
+    mov pc, lp          ; return 0
+
+; ------------------------------------------------------------------------------
+;   uint crc32( const void * buffer, uint size, uint crc )
+;   Continues a CRC-32/MPEG-2 (polynomial 0x04C11DB7, most significant bit
+;       first) over size bytes of buffer
+;   r0          : const void * buffer, Pointer to data
+;   r1          : uint size, Number of bytes to process
+;   r2          : uint crc, CRC of the preceding data
+;   return(r0)  : uint, Updated CRC
+crc32:
+    push r4
+    push r5
+
+    ldr r5, _poly
+    mov r3, #0          ; i = 0
+
+    crc32_byte:
+    cmp r3, r1
+    bge crc32_return    ; while (i < size)
+    ldrb r12, r0, r3
+    lsl r12, r12, #24
+    xor r2, r2, r12     ; crc ^= buffer[i] << 24
+
+    mov r4, #8
+    crc32_bit:
+    cmp r2, #0          ; top = crc < 0
+    lsl r2, r2, #1      ; crc <<= 1
+    xorlt r2, r2, r5    ; if (top) crc ^= poly
+    sub.s r4, r4, #1
+    bgt crc32_bit
+
+    add r3, r3, #1      ; ++i
+    bal crc32_byte
+
+    crc32_return:
+    mov r0, r2
+    pop r5
+    pop r4
+    mov pc, lp          ; return crc
+
+
+; DATA =========================================================================
+
+section .data
+
+_crc:
+    db "crc32: 0x\0"
+_poly:
+    dw 0x04C11DB7
@@ -0,0 +1,73 @@
+; ==============================================================================
+; Benchmark: Recursive Fibonacci
+;   Computes fib(22) with naive recursion to stress calls and the stack
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   report
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+entry main
+
+
+; IMPORTS ======================================================================
+
+; report -------------------------------
+extern print_result
+
+
+; TEXT =========================================================================
+
+section .text
+
+main:
+    push lp
+
+    ldr r0, _n
+    bwl fib             ; value = fib(_n)
+
+    mov r1, r0
+    mov r0, _fib
+    mov r2, #10
+    bwl print_result    ; print_result(_fib, value, #10)
+
+    pop lp
+    mov r0, #0
+    mov pc, lp          ; return 0
+
+; ------------------------------------------------------------------------------
+;   int fib( int n )
+;   Returns the nth Fibonacci number
+;   r0          : int n, Index of the number
+;   return(r0)  : int, fib(n)
+fib:
+    cmp r0, #2
+    movlt pc, lp        ; if (n < 2) return n
+
+    push lp
+    push r4
+    push r5
+
+    mov r4, r0
+    sub r0, r4, #1
+    bwl fib
+    mov r5, r0          ; a = fib(n - 1)
+    sub r0, r4, #2
+    bwl fib             ; b = fib(n - 2)
+    add r0, r0, r5
+
+    pop r5
+    pop r4
+    pop lp
+    mov pc, lp          ; return a + b
+
+
+; DATA =========================================================================
+
+section .data
+
+_fib:
+    db "fib(22): \0"
+_n:
+    dw #22
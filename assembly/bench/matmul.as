@@ -0,0 +1,152 @@
+; ==============================================================================
+; Benchmark: Matrix Multiply
+;   Multiplies two 16x16 integer matrices, repeated over several passes
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   report, stdlib
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+entry main
+
+
+; IMPORTS ======================================================================
+
+; report -------------------------------
+extern print_result
+
+
+; stdlib -------------------------------
+extern salloc
+extern sfree
+
+
+; TEXT =========================================================================
+
+section .text
+
+main:
+    push lp
+    push r4
+    push r5
+    push r6
+    push r7
+
+    mov r0, #3072
+    bwl salloc          ; matrices = salloc(3 * 16 * 16 * 4)
+    mov r4, r0          ; c = matrices
+    add r5, r4, #1024   ; a = c + 256
+    add r6, r5, #1024   ; b = a + 256
+
+    mov r1, #0          ; i = 0
+    matmul_fill_row:
+    mov r2, #0          ; j = 0
+    matmul_fill_col:
+    lsl r3, r1, #4
+    add r3, r3, r2
+    lsl r3, r3, #2      ; offset = (i * 16 + j) * 4
+    add r12, r1, r2
+    str r12, r5, r3     ; a[i][j] = i + j
+    sub r12, r1, r2
+    str r12, r6, r3     ; b[i][j] = i - j
+    add r2, r2, #1
+    cmp r2, #16
+    blt matmul_fill_col
+    add r1, r1, #1
+    cmp r1, #16
+    blt matmul_fill_row
+
+    mov r7, #16         ; passes = 16
+    matmul_pass:
+    mov r0, r4
+    mov r1, r5
+    mov r2, r6
+    bwl matmul          ; matmul(c, a, b)
+    sub.s r7, r7, #1
+    bgt matmul_pass     ; while (--passes > 0)
+
+    mov r1, #0          ; sum = 0
+    mov r2, #0          ; offset = 0
+    matmul_sum:
+    ldr r12, r4, r2
+    mul r3, r12, r2
+    add r1, r1, r3      ; sum += c[offset] * offset
+    add r2, r2, #4
+    cmp r2, #1024
+    blt matmul_sum
+
+    mov r0, _checksum
+    mov r2, #16
+    bwl print_result    ; print_result(_checksum, sum, #16)
+
+    bwl sfree           ; sfree(matrices)
+
+    pop r7
+    pop r6
+    pop r5
+    pop r4
+    pop lp
+    mov r0, #0
+    mov pc, lp          ; return 0
+
+; ------------------------------------------------------------------------------
+;   void matmul( int * c, const int * a, const int * b )
+;   Computes c = a * b for 16x16 row-major matrices
+;   r0          : int * c, Pointer to the product
+;   r1          : const int * a, Pointer to the left operand
+;   r2          : const int * b, Pointer to the right operand
+matmul:
+    push r4
+    push r5
+    push r6
+    push r7
+    push r8
+    push r9
+
+    mov r3, #0          ; row = 0 (row offset in bytes)
+
+    matmul_row:
+    mov r4, #0          ; col = 0 (column offset in bytes)
+
+    matmul_col:
+    mov r5, #0          ; sum = 0
+    add r6, r1, r3      ; pa = &a[row][0]
+    add r7, r2, r4      ; pb = &b[0][col]
+    mov r8, #16         ; k = 16
+
+    matmul_dot:
+    ldr r9, r6
+    ldr r12, r7
+    mul r9, r9, r12
+    add r5, r5, r9      ; sum += *pa * *pb
+    add r6, r6, #4      ; ++pa
+    add r7, r7, #64     ; pb += 16
+    sub.s r8, r8, #1
+    bgt matmul_dot      ; while (--k > 0)
+
+    add r12, r3, r4
+    str r5, r0, r12     ; c[row][col] = sum
+    add r4, r4, #4
+    cmp r4, #64
+    blt matmul_col      ; while (++col < 16)
+
+    add r3, r3, #64
+    cmp r3, #1024
+    blt matmul_row      ; while (++row < 16)
+
+    pop r9
+    pop r8
+    pop r7
+    pop r6
+    pop r5
+    pop r4
+    mov pc, lp          ; return
+
+
+; DATA =========================================================================
+
+section .data
+
+_checksum:
+    db "matmul checksum: 0x\0"
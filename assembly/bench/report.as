@@ -0,0 +1,65 @@
+; ==============================================================================
+; Benchmark Reporting
+;   Prints labelled benchmark results
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   io, string
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+global print_result
+
+
+; IMPORTS ======================================================================
+
+; string -------------------------------
+extern itoa
+
+
+; io ------------------------------------
+extern puts
+
+
+; DEFINITIONS ==================================================================
+
+section .text
+
+; ------------------------------------------------------------------------------
+;   void print_result( const void * label, int value, int base )
+;   Prints a label followed by a value and a newline
+;   r0          : const void * label, C-string naming the result
+;   r1          : int value, Result to print
+;   r2          : int base, Integral radix to print value in
+print_result:
+    push lp
+    push r4
+    push r5
+
+    mov r4, r1
+    mov r5, r2
+    bwl puts            ; puts(label)
+
+    sub sp, sp, #36     ; char buf[36]
+    mov r0, r4
+    mov r1, sp
+    mov r2, r5
+    bwl itoa            ; itoa(value, buf, base)
+    mov r0, sp
+    bwl puts            ; puts(buf)
+    mov r0, _newline
+    bwl puts            ; puts(_newline)
+    add sp, sp, #36     ; free(36)
+
+    pop r5
+    pop r4
+    pop lp
+    mov pc, lp          ; return
+
+
+; DATA =========================================================================
+
+section .data
+
+_newline:
+    db "\n\0"
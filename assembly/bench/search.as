@@ -0,0 +1,158 @@
+; ==============================================================================
+; Benchmark: String Search
+;   Counts pattern occurrences in a 4 KiB text with a naive search
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   report, stdlib, string
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+entry main
+
+
+; IMPORTS ======================================================================
+
+; report -------------------------------
+extern print_result
+
+
+; stdlib -------------------------------
+extern salloc
+extern sfree
+
+
+; string -------------------------------
+extern memcpy
+extern strlen
+
+
+; TEXT =========================================================================
+
+section .text
+
+main:
+    push lp
+    push r4
+    push r5
+    push r6
+    push r7
+
+    mov r0, #4100
+    bwl salloc          ; text = salloc(4100)
+    mov r4, r0
+
+    mov r0, _paragraph
+    bwl strlen
+    mov r5, r0          ; length = strlen(_paragraph)
+    mov r6, #0          ; size = 0
+    mov r7, #4096       ; capacity = 4096
+
+    search_fill:
+    add r0, r4, r6
+    mov r1, _paragraph
+    mov r2, r5
+    bwl memcpy          ; memcpy(text + size, _paragraph, length)
+    add r6, r6, r5      ; size += length
+    add r12, r6, r5
+    cmp r12, r7
+    blt search_fill     ; while (size + length < capacity)
+    mov r12, #0
+    strb r12, r4, r6    ; text[size] = 0
+
+    mov r0, r4
+    mov r1, _the
+    bwl count_matches
+    mov r1, r0
+    mov r0, _the_label
+    mov r2, #10
+    bwl print_result    ; print_result(_the_label, count_matches(text, _the))
+
+    mov r0, r4
+    mov r1, _simulator
+    bwl count_matches
+    mov r1, r0
+    mov r0, _simulator_label
+    mov r2, #10
+    bwl print_result    ; print_result(_simulator_label, ...)
+
+    mov r0, r4
+    mov r1, _missing
+    bwl count_matches
+    mov r1, r0
+    mov r0, _missing_label
+    mov r2, #10
+    bwl print_result    ; print_result(_missing_label, ...)
+
+    bwl sfree           ; sfree(text)
+
+    pop r7
+    pop r6
+    pop r5
+    pop r4
+    pop lp
+    mov r0, #0
+    mov pc, lp          ; return 0
+
+; ------------------------------------------------------------------------------
+;   int count_matches( const void * text, const void * pattern )
+;   Counts the (possibly overlapping) occurrences of pattern in text
+;   r0          : const void * text, C-string to search
+;   r1          : const void * pattern, Non-empty C-string to find
+;   return(r0)  : int, Number of occurrences
+count_matches:
+    push r4
+    push r5
+
+    mov r2, #0          ; count = 0
+
+    count_outer:
+    ldrb r12, r0
+    cmp r12, #0
+    beq count_return    ; while (*text)
+    mov r3, #0          ; k = 0
+
+    count_inner:
+    ldrb r4, r1, r3
+    cmp r4, #0
+    beq count_found     ; if (!pattern[k]) found
+    ldrb r5, r0, r3
+    cmp r4, r5
+    bne count_next      ; if (pattern[k] != text[k]) mismatch
+    add r3, r3, #1      ; ++k
+    bal count_inner
+
+    count_found:
+    add r2, r2, #1      ; ++count
+    count_next:
+    add r0, r0, #1      ; ++text
+    bal count_outer
+
+    count_return:
+    mov r0, r2
+    pop r5
+    pop r4
+    mov pc, lp          ; return count
+
+
+; DATA =========================================================================
+
+section .data
+
+_paragraph:
+    db "The simulator fetches the next instruction, decodes the fields and "
+    db "dispatches to the handler for the opcode. Every handler updates the "
+    db "registers, the status flags or the memory of the machine, and the "
+    db "cycle repeats until the program halts. \0"
+_the:
+    db "the\0"
+_simulator:
+    db "simulator\0"
+_missing:
+    db "interpreter\0"
+_the_label:
+    db "the: \0"
+_simulator_label:
+    db "simulator: \0"
+_missing_label:
+    db "interpreter: \0"
@@ -0,0 +1,101 @@
+; ==============================================================================
+; Benchmark: Sieve of Eratosthenes
+;   Counts the primes below 8192, repeated over several passes
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   report, stdlib, string
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+entry main
+
+
+; IMPORTS ======================================================================
+
+; report -------------------------------
+extern print_result
+
+
+; stdlib -------------------------------
+extern salloc
+extern sfree
+
+
+; string -------------------------------
+extern memset
+
+
+; TEXT =========================================================================
+
+section .text
+
+main:
+    push lp
+    push r4
+    push r5
+    push r6
+    push r7
+    push r8
+
+    mov r8, #8192       ; size = 8192
+    mov r0, r8
+    bwl salloc          ; flags = salloc(size)
+    mov r4, r0
+    mov r7, #10         ; passes = 10
+
+    sieve_pass:
+    mov r0, r4
+    mov r1, #1
+    mov r2, r8
+    bwl memset          ; memset(flags, #1, size)
+
+    mov r5, #0          ; count = 0
+    mov r6, #2          ; i = 2
+
+    sieve_outer:
+    ldrb r12, r4, r6
+    cmp r12, #0
+    beq sieve_next      ; if (!flags[i]) continue
+    add r5, r5, #1      ; ++count
+
+    mul r3, r6, r6      ; j = i * i
+    mov r12, #0
+    sieve_mark:
+    cmp r3, r8
+    bge sieve_next      ; while (j < size)
+    strb r12, r4, r3    ; flags[j] = 0
+    add r3, r3, r6      ; j += i
+    bal sieve_mark
+
+    sieve_next:
+    add r6, r6, #1      ; ++i
+    cmp r6, r8
+    blt sieve_outer     ; while (i < size)
+
+    sub.s r7, r7, #1
+    bgt sieve_pass      ; while (--passes > 0)
+
+    mov r0, _primes
+    mov r1, r5
+    mov r2, #10
+    bwl print_result    ; print_result(_primes, count, #10)
+
+    bwl sfree           ; sfree(flags)
+
+    pop r8
+    pop r7
+    pop r6
+    pop r5
+    pop r4
+    pop lp
+    mov r0, #0
+    mov pc, lp          ; return 0
+
+
+; DATA =========================================================================
+
+section .data
+
+_primes:
+    db "primes below 8192: \0"
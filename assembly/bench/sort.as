@@ -0,0 +1,224 @@
+; ==============================================================================
+; Benchmark: Sorting
+;   Sorts 256 pseudo-random words with bubble sort and insertion sort
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   report, stdlib
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+entry main
+
+
+; IMPORTS ======================================================================
+
+; report -------------------------------
+extern print_result
+
+
+; stdlib -------------------------------
+extern salloc
+extern sfree
+
+
+; TEXT =========================================================================
+
+section .text
+
+main:
+    push lp
+    push r4
+
+    mov r0, #1024
+    bwl salloc          ; array = salloc(256 * 4)
+    mov r4, r0
+
+    mov r1, #256
+    bwl fill            ; fill(array, #256)
+    mov r0, r4
+    mov r1, #256
+    bwl bubble_sort     ; bubble_sort(array, #256)
+    mov r0, r4
+    mov r1, #256
+    bwl checksum
+    mov r1, r0
+    mov r0, _bubble
+    mov r2, #16
+    bwl print_result    ; print_result(_bubble, checksum(array, #256), #16)
+
+    mov r0, r4
+    mov r1, #256
+    bwl fill            ; fill(array, #256)
+    mov r0, r4
+    mov r1, #256
+    bwl insertion_sort  ; insertion_sort(array, #256)
+    mov r0, r4
+    mov r1, #256
+    bwl checksum
+    mov r1, r0
+    mov r0, _insertion
+    mov r2, #16
+    bwl print_result    ; print_result(_insertion, checksum(array, #256), #16)
+
+    bwl sfree           ; sfree(array)
+
+    pop r4
+    pop lp
+    mov r0, #0
+    mov pc, lp          ; return 0
+
+; ------------------------------------------------------------------------------
+;   void fill( int * array, uint size )
+;   Fills array with the same pseudo-random values (0 to 1023) on every call
+;   r0          : int * array, Pointer to array
+;   r1          : uint size, Number of elements
+fill:
+    push r4
+    push r5
+
+    ldr r2, _multiplier
+    mov r3, #1          ; seed = 1
+    mov r5, #2048       ; udv divisors are limited to 12 bits
+    lsl r1, r1, #2      ; i = size * 4
+
+    fill_loop:
+    mul r3, r3, r2
+    add r3, r3, #1013   ; seed = seed * multiplier + 1013
+    udv r4, r3, r5
+    udv r4, r4, r5      ; value = seed >> 22
+    sub.s r1, r1, #4
+    str r4, r0, r1      ; array[--i] = value
+    bgt fill_loop
+
+    pop r5
+    pop r4
+    mov pc, lp          ; return
+
+; ------------------------------------------------------------------------------
+;   int checksum( const int * array, uint size )
+;   Returns a position-weighted sum of array, or -1 if array is not sorted
+;   r0          : const int * array, Pointer to array
+;   r1          : uint size, Number of elements
+;   return(r0)  : int, Checksum
+checksum:
+    push r4
+    push r5
+
+    mov r2, #0          ; sum = 0
+    mov r3, #0          ; i = 0
+    mov r5, #0          ; previous = 0
+    lsl r1, r1, #2      ; end = size * 4
+
+    checksum_loop:
+    ldr r4, r0, r3
+    cmp r4, r5
+    blt checksum_unsorted
+    mov r5, r4          ; previous = array[i]
+    add r3, r3, #4
+    mul r12, r4, r3
+    add r2, r2, r12     ; sum += array[i] * (i + 1)
+    cmp r3, r1
+    blt checksum_loop
+
+    mov r0, r2
+    pop r5
+    pop r4
+    mov pc, lp          ; return sum
+
+    checksum_unsorted:
+    mov r0, #-1
+    pop r5
+    pop r4
+    mov pc, lp          ; return -1
+
+; ------------------------------------------------------------------------------
+;   void bubble_sort( int * array, uint size )
+;   Sorts array in ascending order
+;   r0          : int * array, Pointer to array
+;   r1          : uint size, Number of elements
+bubble_sort:
+    push r4
+    push r5
+
+    sub r1, r1, #1
+    lsl r1, r1, #2      ; last = (size - 1) * 4
+
+    bubble_outer:
+    cmp r1, #0
+    ble bubble_return   ; while (last > 0)
+    mov r2, #0          ; i = 0
+
+    bubble_inner:
+    cmp r2, r1
+    bge bubble_next     ; while (i < last)
+    add r3, r2, #4
+    ldr r4, r0, r2
+    ldr r5, r0, r3
+    cmp r4, r5
+    ble bubble_skip     ; if (array[i] > array[i + 1])
+    str r5, r0, r2
+    str r4, r0, r3      ; swap(array[i], array[i + 1])
+    bubble_skip:
+    mov r2, r3          ; ++i
+    bal bubble_inner
+
+    bubble_next:
+    sub r1, r1, #4      ; --last
+    bal bubble_outer
+
+    bubble_return:
+    pop r5
+    pop r4
+    mov pc, lp          ; return
+
+; ------------------------------------------------------------------------------
+;   void insertion_sort( int * array, uint size )
+;   Sorts array in ascending order
+;   r0          : int * array, Pointer to array
+;   r1          : uint size, Number of elements
+insertion_sort:
+    push r4
+    push r5
+
+    lsl r1, r1, #2      ; end = size * 4
+    mov r2, #4          ; i = 1
+
+    insertion_outer:
+    cmp r2, r1
+    bge insertion_return ; while (i < end)
+    ldr r4, r0, r2      ; key = array[i]
+    mov r3, r2          ; j = i
+
+    insertion_inner:
+    cmp r3, #0
+    ble insertion_place ; while (j > 0
+    sub r12, r3, #4
+    ldr r5, r0, r12
+    cmp r5, r4
+    ble insertion_place ;     && array[j - 1] > key)
+    str r5, r0, r3      ; array[j] = array[j - 1]
+    mov r3, r12         ; --j
+    bal insertion_inner
+
+    insertion_place:
+    str r4, r0, r3      ; array[j] = key
+    add r2, r2, #4      ; ++i
+    bal insertion_outer
+
+    insertion_return:
+    pop r5
+    pop r4
+    mov pc, lp          ; return
+
+
+; DATA =========================================================================
+
+section .data
+
+_bubble:
+    db "bubble sort: 0x\0"
+_insertion:
+    db "insertion sort: 0x\0"
+_multiplier:
+    dw 0x000041A7
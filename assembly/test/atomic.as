@@ -0,0 +1,151 @@
+; ==============================================================================
+; Test file 7
+;   Spinlock and lock-free counters shared between four cores
+;   (simulate --cores=4)
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   io, string
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+entry main
+
+
+; IMPORTS ======================================================================
+
+; string -------------------------------
+extern itoa
+
+
+; io ------------------------------------
+extern puts
+
+
+; TEXT =========================================================================
+
+section .text
+
+main:
+    srl r0, cid
+    cmp r0, #0
+    bne work            ; if (cid != 0) work()
+
+    push lp
+    push r4
+
+    ; A store-exclusive needs a reservation from a load-exclusive
+    mov r4, _probe
+    mov r0, #5
+    strex r0, r4
+    bwl print_value     ; print_value(1), no reservation
+    ldrex r0, r4
+    add r0, r0, #1
+    strex r0, r4
+    bwl print_value     ; print_value(0), stored
+    ldr r0, r4
+    bwl print_value     ; print_value(_probe)
+
+    ; Count alongside the other cores, then wait for all of them
+    bwl work
+main_wait:
+    mov r1, _done
+    ldr r0, r1
+    cmp r0, #4
+    bne main_wait       ; while (_done != 4);
+
+    mov r1, _locked
+    ldr r0, r1
+    bwl print_value     ; print_value(_locked)
+    mov r1, _counted
+    ldr r0, r1
+    bwl print_value     ; print_value(_counted)
+
+    pop r4
+    pop lp
+    mov r0, #0
+    mov pc, lp          ; return 0
+
+; ------------------------------------------------------------------------------
+;   void work( void )
+;   Increments _locked under a swp spinlock and _counted with ldrex/strex
+;       1000 times each, then increments _done
+work:
+    push lp
+
+    mov r3, #1000
+work_loop:
+    mov r1, _lock
+work_acquire:
+    mov r0, #1
+    swp r0, r1
+    cmp r0, #0
+    bne work_acquire    ; while (swp(&_lock, 1));
+    mov r2, _locked
+    ldr r0, r2
+    add r0, r0, #1
+    str r0, r2          ; ++_locked
+    mov r0, #0
+    str r0, r1          ; _lock = 0
+
+    mov r2, _counted
+    bwl increment       ; increment(&_counted)
+
+    sub.s r3, r3, #1
+    bne work_loop
+
+    mov r2, _done
+    bwl increment       ; increment(&_done)
+
+    pop lp
+    mov pc, lp          ; return, or halt on secondary cores
+
+; ------------------------------------------------------------------------------
+;   void increment( int *value )
+;   Atomically increments a word
+;   r2          : int *value, Word to increment
+increment:
+    ldrex r0, r2
+    add r0, r0, #1
+    strex r0, r2
+    cmp r0, #0
+    bne increment       ; while (!strex(value, ldrex(value) + 1));
+    mov pc, lp          ; return
+
+; ------------------------------------------------------------------------------
+;   void print_value( int value )
+;   Prints a decimal value and a newline
+;   r0          : int value, Number to print
+print_value:
+    push lp
+
+    sub sp, sp, #16     ; char buf[16]
+    mov r1, sp
+    mov r2, #10
+    bwl itoa            ; itoa(value, buf, #10)
+    mov r0, sp
+    bwl puts            ; puts(buf)
+    mov r0, _newline
+    bwl puts            ; puts(_newline)
+    add sp, sp, #16     ; free(16)
+
+    pop lp
+    mov pc, lp          ; return
+
+
+; DATA =========================================================================
+
+section .data
+
+_lock:
+    dw 0x00
+_locked:
+    dw 0x00
+_counted:
+    dw 0x00
+_done:
+    dw 0x00
+_probe:
+    dw 0x00
+_newline:
+    db "\n\0"
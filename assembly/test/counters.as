@@ -0,0 +1,103 @@
+; ==============================================================================
+; Test file 5
+;   Times library routines with the instruction counter
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   io, string
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+entry main
+
+
+; IMPORTS ======================================================================
+
+; string -------------------------------
+extern itoa
+extern strcpy
+
+
+; io ------------------------------------
+extern puts
+
+
+; TEXT =========================================================================
+
+section .text
+
+main:
+    push lp
+    push r4
+    push r5
+    push r6
+
+    sub sp, sp, #64     ; alloc(64)
+    add r4, sp, #32     ; char num[32]
+    add r5, sp, #0      ; char str[32]
+
+    srl r6, ic
+    mov r0, r5
+    mov r1, _message
+    bwl strcpy          ; strcpy(str, _message)
+    srl r0, ic
+    sub r0, r0, r6
+    bwl print_count     ; print_count(instructions)
+
+    srl r6, ic
+    ldr r0, _value
+    mov r1, r4
+    mov r2, #10
+    bwl itoa            ; itoa(_value, num, #10)
+    srl r0, ic
+    sub r0, r0, r6
+    bwl print_count     ; print_count(instructions)
+
+    srl r6, ic
+    srl r0, ic
+    sub r0, r0, r6
+    bwl print_count     ; print_count(1)
+
+    srl r0, ich
+    bwl print_count     ; print_count(0)
+
+    add sp, sp, #64     ; free(64)
+
+    pop r6
+    pop r5
+    pop r4
+    pop lp
+    mov r0, #0
+    mov pc, lp          ; return 0
+
+; ------------------------------------------------------------------------------
+;   void print_count( int count )
+;   Prints a decimal instruction count
+;   r0          : int count, Number to print
+print_count:
+    push lp
+
+    sub sp, sp, #16     ; char buf[16]
+    mov r1, sp
+    mov r2, #10
+    bwl itoa            ; itoa(count, buf, #10)
+    mov r0, sp
+    bwl puts            ; puts(buf)
+    mov r0, _newline
+    bwl puts            ; puts(_newline)
+    add sp, sp, #16     ; free(16)
+
+    pop lp
+    mov pc, lp          ; return
+
+
+; DATA =========================================================================
+
+section .data
+
+_message:
+    db "Hello, counters!\n\0"
+_newline:
+    db "\n\0"
+_value:
+    dw 0x0001E240
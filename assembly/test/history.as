@@ -0,0 +1,53 @@
+; ==============================================================================
+; Test file 9
+;   Stack buffer overflow that corrupts a saved link pointer; the return
+;   through it aborts (simulate --last-write=0xfff0 finds the culprit)
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   None
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+entry main
+
+
+; TEXT =========================================================================
+
+section .text
+
+main:
+    push lp
+    bwl parse           ; parse()
+    pop lp
+    mov r0, #0
+    mov pc, lp          ; return 0
+
+; ------------------------------------------------------------------------------
+;   void parse( void )
+;   Fills a four-word buffer on the stack, but with five words
+parse:
+    push lp
+
+    sub sp, sp, #16     ; int buf[4]
+    mov r0, sp
+    mov r1, #5
+    bwl fill            ; fill(buf, #5), one word too many
+    add sp, sp, #16     ; free(16)
+
+    pop lp
+    mov pc, lp          ; return, through the overwritten lp
+
+; ------------------------------------------------------------------------------
+;   void fill( int * buffer, int count )
+;   Stores count words of -1
+;   r0          : int * buffer, Words to fill
+;   r1          : int count, Number of words
+fill:
+    mvn r2, #0
+fill_loop:
+    str r2, r0
+    add r0, r0, #4
+    sub.s r1, r1, #1
+    bne fill_loop       ; while (--count)
+    mov pc, lp          ; return
@@ -0,0 +1,96 @@
+; ==============================================================================
+; Test file 11
+;   Core 0 spins on a flag while core 1 computes (simulate --cores=2). On one
+;   core nothing sets the flag, and the simulator reports the idle loop.
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   io, string
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+entry main
+
+
+; IMPORTS ======================================================================
+
+; string -------------------------------
+extern itoa
+
+
+; io ------------------------------------
+extern puts
+
+
+; TEXT =========================================================================
+
+section .text
+
+main:
+    srl r0, cid
+    cmp r0, #0
+    bne worker          ; if (cid != 0) worker()
+
+    push lp
+
+main_wait:
+    ldr r0, _done
+    cmp r0, #0
+    beq main_wait       ; while (!_done);
+
+    ldr r0, _result
+    bwl print_value     ; print_value(_result)
+
+    pop lp
+    mov r0, #0
+    mov pc, lp          ; return 0
+
+; ------------------------------------------------------------------------------
+;   void worker( void )
+;   Sums 1 to 50000 into _result, then sets _done
+worker:
+    mov r1, #0
+    ldr r2, _count
+worker_loop:
+    add r1, r1, r2
+    sub.s r2, r2, #1
+    bne worker_loop     ; while (--count)
+
+    str r1, _result
+    mov r1, #1
+    str r1, _done       ; _done = 1, publishing _result
+    mov pc, lp          ; halt
+
+; ------------------------------------------------------------------------------
+;   void print_value( int value )
+;   Prints a decimal value and a newline
+;   r0          : int value, Number to print
+print_value:
+    push lp
+
+    sub sp, sp, #16     ; char buf[16]
+    mov r1, sp
+    mov r2, #10
+    bwl itoa            ; itoa(value, buf, #10)
+    mov r0, sp
+    bwl puts            ; puts(buf)
+    mov r0, _newline
+    bwl puts            ; puts(_newline)
+    add sp, sp, #16     ; free(16)
+
+    pop lp
+    mov pc, lp          ; return
+
+
+; DATA =========================================================================
+
+section .data
+
+_count:
+    dw 0x0000C350
+_result:
+    dw 0x00
+_done:
+    dw 0x00
+_newline:
+    db "\n\0"
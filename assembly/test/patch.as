@@ -0,0 +1,144 @@
+; ==============================================================================
+; Test file 12
+;   Patches its own code once it is hot: a whole instruction of a function,
+;   the branch inside a compare and branch pair, and the immediate byte of
+;   an instruction. Each result must match the reference engine.
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   io, string
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+entry main
+
+
+; IMPORTS ======================================================================
+
+; string -------------------------------
+extern itoa
+
+
+; io ------------------------------------
+extern puts
+
+
+; TEXT =========================================================================
+
+section .text
+
+main:
+    push lp
+    push r4
+    push r5
+
+    mov r4, #0
+    mov r5, #100
+call_loop:
+    bwl get_value
+    add r4, r4, r0
+    sub.s r5, r5, #1
+    bne call_loop               ; 100 calls of get_value() == 1
+
+    ldr r1, get_two
+    str r1, get_value           ; get_value() now returns 2
+    mov r5, #100
+patched_loop:
+    bwl get_value
+    add r4, r4, r0
+    sub.s r5, r5, #1
+    bne patched_loop            ; 100 calls of get_value() == 2
+
+    mov r0, _call_str
+    mov r1, r4
+    bwl print_count             ; print_count(_call_str, 300)
+
+    mov r1, #50
+    bwl count_to                ; count_to(50), hot loop
+    ldr r1, add_hundred
+    str r1, count_branch        ; the bne becomes add r0, r0, #100
+    mov r1, #50
+    bwl count_to                ; one pass through the loop
+    mov r1, r0
+    mov r0, _branch_str
+    bwl print_count             ; print_count(_branch_str, 101)
+
+    mov r0, #7
+    mov r1, get_value
+    strb r0, r1, #3             ; the immediate byte of mov r0, #2
+    bwl get_value
+    mov r1, r0
+    mov r0, _byte_str
+    bwl print_count             ; print_count(_byte_str, 7)
+
+    pop r5
+    pop r4
+    pop lp
+    mov r0, #0
+    mov pc, lp                  ; return 0
+
+; ------------------------------------------------------------------------------
+;   int get_value( void )
+;   Returns 1 until patched
+get_value:
+    mov r0, #1
+    mov pc, lp                  ; return 1
+
+; ------------------------------------------------------------------------------
+;   int count_to( int limit )
+;   Counts up to limit until patched
+;   r1          : int limit, Value to count to
+count_to:
+    mov r0, #0
+count_loop:
+    add r0, r0, #1
+    cmp r0, r1
+count_branch:
+    bne count_loop              ; while (++count != limit)
+    mov pc, lp                  ; return count
+
+; ------------------------------------------------------------------------------
+;   void print_count( char * label, int count )
+;   Prints a label and a decimal count
+;   r0          : char * label, String to print first
+;   r1          : int count, Number to print
+print_count:
+    push lp
+    push r4
+
+    mov r4, r1
+    bwl puts                    ; puts(label)
+    sub sp, sp, #16             ; char buf[16]
+    mov r0, r4
+    mov r1, sp
+    mov r2, #10
+    bwl itoa                    ; itoa(count, buf, #10)
+    mov r0, sp
+    bwl puts                    ; puts(buf)
+    mov r0, _newline
+    bwl puts                    ; puts(_newline)
+    add sp, sp, #16             ; free(16)
+
+    pop r4
+    pop lp
+    mov pc, lp                  ; return
+
+; Patches, never executed in place ---------------------------------------------
+get_two:
+    mov r0, #2
+add_hundred:
+    add r0, r0, #100
+
+
+; DATA =========================================================================
+
+section .data
+
+_call_str:
+    db "patched call: \0"
+_branch_str:
+    db "patched branch: \0"
+_byte_str:
+    db "patched byte: \0"
+_newline:
+    db "\n\0"
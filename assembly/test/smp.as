@@ -0,0 +1,128 @@
+; ==============================================================================
+; Test file 6
+;   Message passing and inter-processor interrupts between four cores
+;   (simulate --cores=4)
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   io, string
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+entry main
+
+
+; IMPORTS ======================================================================
+
+; string -------------------------------
+extern itoa
+
+
+; io ------------------------------------
+extern puts
+
+
+; TEXT =========================================================================
+
+section .text
+
+main:
+    srl r0, cid
+    cmp r0, #0
+    bne secondary       ; if (cid != 0) secondary(cid)
+
+    push lp
+    push r4
+
+    ; Wait for every secondary core to publish its message
+    mov r4, #1
+main_wait:
+    lsl r12, r4, #2
+    mov r1, _ready
+    ldr r0, r1, r12
+    cmp r0, #0
+    beq main_wait       ; while (!_ready[core]);
+    mov r1, _message
+    ldr r0, r1, r12
+    bwl print_value     ; print_value(_message[core])
+    add r4, r4, #1
+    cmp r4, #4
+    blt main_wait
+
+    ; Interrupt every secondary core and wait for the acknowledgements
+    mov r4, #1
+main_interrupt:
+    mov r0, r4
+    swi 0x20            ; ipi(core)
+main_ack:
+    lsl r12, r4, #2
+    mov r1, _ack
+    ldr r0, r1, r12
+    cmp r0, #0
+    beq main_ack        ; while (!_ack[core]);
+    bwl print_value     ; print_value(_ack[core])
+    add r4, r4, #1
+    cmp r4, #4
+    blt main_interrupt
+
+    pop r4
+    pop lp
+    mov r0, #0
+    mov pc, lp          ; return 0
+
+; ------------------------------------------------------------------------------
+;   void secondary( int core )
+;   Publishes a message, then acknowledges the first inter-processor interrupt
+;       with the mask of cores that sent it
+;   r0          : int core, Number of this core
+secondary:
+    lsl r12, r0, #2
+    mul r1, r0, #100
+    add r1, r1, #7
+    mov r2, _message
+    str r1, r2, r12     ; _message[core] = core * 100 + 7
+    mov r1, #1
+    mov r2, _ready
+    str r1, r2, r12     ; _ready[core] = 1, publishing _message[core]
+
+secondary_wait:
+    srl r1, ipi
+    cmp r1, #0
+    beq secondary_wait  ; while (!(pending = ipi));
+    mov r2, _ack
+    str r1, r2, r12     ; _ack[core] = pending
+    mov pc, lp          ; halt
+
+; ------------------------------------------------------------------------------
+;   void print_value( int value )
+;   Prints a decimal value and a newline
+;   r0          : int value, Number to print
+print_value:
+    push lp
+
+    sub sp, sp, #16     ; char buf[16]
+    mov r1, sp
+    mov r2, #10
+    bwl itoa            ; itoa(value, buf, #10)
+    mov r0, sp
+    bwl puts            ; puts(buf)
+    mov r0, _newline
+    bwl puts            ; puts(_newline)
+    add sp, sp, #16     ; free(16)
+
+    pop lp
+    mov pc, lp          ; return
+
+
+; DATA =========================================================================
+
+section .data
+
+_message:
+    space #16
+_ready:
+    space #16
+_ack:
+    space #16
+_newline:
+    db "\n\0"
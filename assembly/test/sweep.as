@@ -0,0 +1,55 @@
+; ==============================================================================
+; Test file 8
+;   Parameter sweep: one pseudo-random walk per instance, seeded with the
+;   instance number (simulate --batch=16)
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   None
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+entry main
+
+
+; TEXT =========================================================================
+
+section .text
+
+main:
+    push lp
+    bwl walk            ; r0 = walk(r0)
+    pop lp
+    mov pc, lp          ; return r0
+
+; ------------------------------------------------------------------------------
+;   int walk( int seed )
+;   Steps a linear congruential generator 1000 times and counts the states
+;       with the top bit set; odd seeds also add the seed
+;   r0          : int seed, Initial state
+;   return      : int, Number of states with the top bit set (+ seed if odd)
+walk:
+    push r4
+
+    mov r1, r0          ; x = seed
+    mov r2, #0          ; count = 0
+    mov r3, #1000       ; i = 1000
+    mov r4, #4005
+    mov r12, #1
+    lsl r12, r12, #31
+walk_loop:
+    mul r1, r1, r4
+    add r1, r1, #1      ; x = x * 4005 + 1
+    tst r1, r12
+    addne r2, r2, #1    ; if (x & 0x80000000) ++count
+    sub.s r3, r3, #1
+    bne walk_loop       ; while (--i)
+
+    tst r0, #1
+    beq walk_done       ; if (seed & 1)
+    add r2, r2, r0      ;     count += seed
+walk_done:
+    mov r0, r2
+
+    pop r4
+    mov pc, lp          ; return count
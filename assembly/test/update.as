@@ -0,0 +1,41 @@
+; ==============================================================================
+; Test file 13
+;   Pushes and pops that update the status register, in the places where the
+;   predecoded engine fuses plain pushes and pops (a push pair and a pop, pop,
+;   return epilogue). Returns st, which must match the reference engine,
+;   also in every instance of simulate --batch.
+;   The assembler has no push.s or pop.s, so they are written as words.
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   None
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+entry main
+
+
+; TEXT =========================================================================
+
+section .text
+
+main:
+    push lp
+    bwl update          ; update()
+    srl r0, st
+    pop lp
+    mov pc, lp          ; return st
+
+; ------------------------------------------------------------------------------
+;   void update( void )
+;   Clears Z before each pair of updating pushes and pops, which set it
+update:
+    mov r1, #1
+    cmp r1, #0          ; Z = 0
+    dw 0xE570000E       ; push.s lp
+    dw 0xE5700001       ; push.s r1
+
+    cmp r1, #0          ; Z = 0
+    dw 0xE5800001       ; pop.s r1
+    dw 0xE580000E       ; pop.s lp
+    mov pc, lp          ; return
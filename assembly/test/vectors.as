@@ -0,0 +1,186 @@
+; ==============================================================================
+; Test file 10
+;   Emulates an undefined instruction, skips a push.s and a pop.s on an
+;   empty stack and pages in an unmapped load from the abort handlers
+;   (simulate --exceptions=vector)
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   io, string
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+entry __vectors
+
+
+; IMPORTS ======================================================================
+
+; string -------------------------------
+extern itoa
+
+
+; io ------------------------------------
+extern puts
+
+
+; Vector Table =================================================================
+
+section .text
+
+__vectors:
+    b main                      ; <reset>
+    b undefined_handler         ; <undefined_instruction>
+    b fatal                     ; <software_interrupt>
+    b fatal                     ; <prefetch_abort>
+    b page_handler              ; <data_abort>
+    b fatal                     ; <usage_abort>
+
+
+; TEXT =========================================================================
+
+main:
+    push lp
+    push r4
+    push r5
+
+    mov r4, #3
+main_loop:
+    dw 0xE0000000               ; noop, undefined: emulated by the handler
+    sub.s r4, r4, #1
+    bne main_loop               ; three times
+
+    mov r1, #1
+    str r1, skip_aborts         ; the data abort handler skips the next two
+    mov r5, sp
+    cmp r1, #0                  ; Z = 0
+    mov sp, #0
+    dw 0xE5700001               ; push.s r1, aborts below the stack
+    beq fatal                   ; an aborted push.s must not set Z
+    sub sp, sp, #4
+    dw 0xE5800001               ; pop.s r1, aborts above the stack
+    beq fatal                   ; an aborted pop.s must not set Z
+    mov sp, r5
+    mov r1, #0
+    str r1, skip_aborts
+
+    ldr r1, _window
+    ldr r0, r1                  ; aborts; the handler maps r1 and retries
+    ldr r4, _page
+    cmp r0, r4
+    bne fatal                   ; the retry must load the paged-in word
+
+    mov r0, _undefined_str
+    ldr r1, undefined_count
+    bwl print_count             ; print_count(_undefined_str, 3)
+    mov r0, _aborts_str
+    ldr r1, abort_count
+    bwl print_count             ; print_count(_aborts_str, 3)
+    mov r0, _far_str
+    ldr r1, fault_address
+    bwl print_count             ; print_count(_far_str, 65536)
+
+    pop r5
+    pop r4
+    pop lp
+    mov r0, #0
+    mov pc, lp                  ; return 0
+
+; ------------------------------------------------------------------------------
+;   void print_count( char * label, int count )
+;   Prints a label and a decimal count
+;   r0          : char * label, String to print first
+;   r1          : int count, Number to print
+print_count:
+    push lp
+    push r4
+
+    mov r4, r1
+    bwl puts                    ; puts(label)
+    sub sp, sp, #16             ; char buf[16]
+    mov r0, r4
+    mov r1, sp
+    mov r2, #10
+    bwl itoa                    ; itoa(count, buf, #10)
+    mov r0, sp
+    bwl puts                    ; puts(buf)
+    mov r0, _newline
+    bwl puts                    ; puts(_newline)
+    add sp, sp, #16             ; free(16)
+
+    pop r4
+    pop lp
+    mov pc, lp                  ; return
+
+
+; Abort Handlers ===============================================================
+;   Run in abort mode with lp holding the address of the faulting
+;   instruction and sv the interrupted st. sp_abt is not set up, so the
+;   handlers save what they use to memory.
+
+undefined_handler:
+    str r12, saved_r12
+    ldr r12, undefined_count
+    add r12, r12, #1
+    str r12, undefined_count
+    add r12, lp, #4
+    str r12, saved_lp           ; resume after the instruction
+    b return_from_abort
+
+page_handler:
+    str r12, saved_r12
+    ldr r12, abort_count
+    add r12, r12, #1
+    str r12, abort_count
+    srl r12, far
+    str r12, fault_address
+    ldr r12, skip_aborts
+    cmp r12, #0
+    bne skip_abort
+    mov r1, _page               ; map the window onto _page
+    str lp, saved_lp            ; retry the instruction
+    b return_from_abort
+
+skip_abort:
+    add r12, lp, #4
+    str r12, saved_lp           ; resume after the instruction
+    b return_from_abort
+
+return_from_abort:
+    srl r12, sv
+    srs st, r12                 ; back to the interrupted mode and flags
+    ldr r12, saved_r12
+    ldr pc, saved_lp
+
+fatal:
+    mov r0, 0x7F
+    halt
+
+
+; DATA =========================================================================
+
+section .data
+
+_undefined_str:
+    db "undefined: \0"
+_aborts_str:
+    db "aborts: \0"
+_far_str:
+    db "far: \0"
+_newline:
+    db "\n\0"
+_window:
+    dw 0x00010000
+_page:
+    dw 0x12345678
+undefined_count:
+    dw 0x00
+abort_count:
+    dw 0x00
+skip_aborts:
+    dw 0x00
+fault_address:
+    dw 0x00
+saved_r12:
+    dw 0x00
+saved_lp:
+    dw 0x00
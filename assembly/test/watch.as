@@ -0,0 +1,48 @@
+; ==============================================================================
+; Test file 14
+;   Stack accesses inside the sequences the predecoded engine fuses: a push
+;   pair, the memset and memcpy loops and a pop, pop, return epilogue
+;   (simulate --watch=0xffe8,16:rw). Every hit must report the same
+;   instruction and instruction count as on the reference engine.
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   string
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+entry main
+
+
+; IMPORTS ======================================================================
+
+; string -------------------------------
+extern memcpy
+extern memset
+
+
+; TEXT =========================================================================
+
+section .text
+
+main:
+    push lp
+    push r4             ; saved at 0xfff0 to 0xfff7
+
+    sub sp, sp, #16     ; char dest[8] at 0xffe0, src[8] at 0xffe8
+    add r0, sp, #8
+    mov r1, #42
+    mov r2, #8
+    bwl memset          ; memset(src, 42, 8)
+
+    mov r0, sp
+    add r1, sp, #8
+    mov r2, #8
+    bwl memcpy          ; memcpy(dest, src, 8)
+
+    ldrb r0, sp, #7     ; dest[7]
+    add sp, sp, #16     ; free(16)
+
+    pop r4
+    pop lp
+    mov pc, lp          ; return dest[7]
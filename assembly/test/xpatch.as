@@ -0,0 +1,118 @@
+; ==============================================================================
+; Test file 15
+;   Core 1 patches a function that core 0 has already run hot (simulate
+;   --cores=2). Core 0 must see the patched code on every engine.
+;
+;   Author:         Matthew Edwards
+;   Dependencies:   io, string
+; ==============================================================================
+
+; EXPORTS ======================================================================
+
+entry main
+
+
+; IMPORTS ======================================================================
+
+; string -------------------------------
+extern itoa
+
+
+; io ------------------------------------
+extern puts
+
+
+; TEXT =========================================================================
+
+section .text
+
+main:
+    srl r0, cid
+    cmp r0, #0
+    bne patcher         ; if (cid != 0) patcher()
+
+    push lp
+    push r4
+    push r5
+
+    mov r4, #0
+    mov r5, #100
+call_loop:
+    bwl get_value
+    add r4, r4, r0
+    sub.s r5, r5, #1
+    bne call_loop       ; 100 calls of get_value() == 1
+
+    mov r1, #1
+    str r1, _go         ; _go = 1, core 1 patches get_value
+main_wait:
+    ldr r0, _patched
+    cmp r0, #0
+    beq main_wait       ; while (!_patched);
+
+    bwl get_value
+    add r0, r4, r0
+    bwl print_value     ; print_value(100 + 2)
+
+    pop r5
+    pop r4
+    pop lp
+    mov r0, #0
+    mov pc, lp          ; return 0
+
+; ------------------------------------------------------------------------------
+;   void patcher( void )
+;   Waits for _go, makes get_value return 2, then sets _patched
+patcher:
+    ldr r0, _go
+    cmp r0, #0
+    beq patcher         ; while (!_go);
+
+    ldr r1, get_two
+    str r1, get_value   ; get_value() now returns 2
+    mov r1, #1
+    str r1, _patched    ; _patched = 1, publishing the patch
+    mov pc, lp          ; halt
+
+; ------------------------------------------------------------------------------
+;   int get_value( void )
+;   Returns 1 until patched
+get_value:
+    mov r0, #1
+    mov pc, lp          ; return 1
+
+; ------------------------------------------------------------------------------
+;   void print_value( int value )
+;   Prints a decimal value and a newline
+;   r0          : int value, Number to print
+print_value:
+    push lp
+
+    sub sp, sp, #16     ; char buf[16]
+    mov r1, sp
+    mov r2, #10
+    bwl itoa            ; itoa(value, buf, #10)
+    mov r0, sp
+    bwl puts            ; puts(buf)
+    mov r0, _newline
+    bwl puts            ; puts(_newline)
+    add sp, sp, #16     ; free(16)
+
+    pop lp
+    mov pc, lp          ; return
+
+; Patch, never executed in place -----------------------------------------------
+get_two:
+    mov r0, #2
+
+
+; DATA =========================================================================
+
+section .data
+
+_go:
+    dw 0x00
+_patched:
+    dw 0x00
+_newline:
+    db "\n\0"
@@ -8,6 +8,7 @@
  * =============================================================================
  */
 
+#include <algorithm>
 #include <cmath>
 #include <iomanip>
 
@@ -671,6 +672,12 @@ int m20::Assembler::getLoadOpcode(const InstructionCommand &command)
             return 0x00600000;
         case InstructionCommand::STRH:
             return 0x00700000;
+        case InstructionCommand::SWP:
+            return 0x00800000;
+        case InstructionCommand::LDREX:
+            return 0x00900000;
+        case InstructionCommand::STREX:
+            return 0x00A00000;
         default:
             assert(false);
             return 0;
@@ -704,6 +711,17 @@ void m20::Assembler::updateLabels()
         }
     }
 
+    // Every other label is local; the linker resolves references to them
+    // across sections and lists them in its symbol map
+    for (const auto &label : labels)
+    {
+        if (std::find(globals.begin(), globals.end(), label.first)
+            == globals.end())
+        {
+            addSymbol(SymbolType::LOCAL, label.second);
+        }
+    }
+
     for (const auto &e : externs)
     {
         auto i = labels.find(e.label);
@@ -763,7 +781,6 @@ void m20::Assembler::updateLabels()
                 }
                 else
                 {
-                    addSymbol(SymbolType::LOCAL, i->second);
                     addRelocation(fixup.type, fixup.index, fixup.label);
                 }
             }
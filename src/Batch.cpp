@@ -0,0 +1,818 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Lockstep batch execution of many instances of one program.
+ *      (Implementation)
+ * =============================================================================
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iomanip>
+#include <map>
+
+#include "Batch.h"
+#include "Utils.h"
+
+namespace
+{
+    const int COND_AL = 0xE;
+    const int ST_C = 0x20000000;
+
+    /**
+     * Returns true if the instruction reads or writes PC through a register
+     *  field. Such instructions run lane by lane.
+     */
+    bool touchesPc(const m20::DecodedInstruction &d)
+    {
+        using m20::Address;
+        using m20::Op;
+
+        bool rm = !d.immediate && d.rm == 15;
+        if (d.op >= Op::LDR && d.op <= Op::STRH)
+        {
+            bool base = d.address == Address::BASE_IMMEDIATE
+                        || d.address == Address::BASE_REGISTER;
+            bool index = d.address == Address::BASE_REGISTER
+                         || d.address == Address::REGISTER;
+            return d.rd == 15 || (base && d.rn == 15) || (index && d.rm == 15);
+        }
+        else if (d.op == Op::POP)
+        {
+            return d.rm == 15;
+        }
+        else if (d.op == Op::PUSH || d.op == Op::B || d.op == Op::BWL)
+        {
+            return rm;
+        }
+        bool rn = d.op >= Op::ADD && d.op <= Op::LSL && d.rn == 15;
+        return d.rd == 15 || rn || rm;
+    }
+}
+
+m20::Batch::Batch(size_t memorySize, unsigned int count)
+        : discard(nullptr),
+          statuses(count, Status::RUNNING),
+          codeEnd(0),
+          lockstep(0),
+          file((size_t) 16 * count),
+          banks(count),
+          targets(count),
+          operands(count),
+          zeros(count, 0),
+          passed(count),
+          exits(count),
+          pc(0),
+          target(0),
+          executed(0),
+          retired(0),
+          diverged(false),
+          codeWritten(false)
+{
+    assert(count >= 1 && count <= MAX_LANES);
+    for (unsigned int id = 0; id < count; ++id)
+    {
+        lanes.emplace_back(new Simulator(memorySize));
+        lanes.back()->setOutput(discard);
+    }
+}
+
+bool m20::Batch::load(const std::string &fname)
+{
+    for (auto &lane : lanes)
+    {
+        if (!lane->load(fname))
+        {
+            return false;
+        }
+    }
+    analyze();
+    return true;
+}
+
+bool m20::Batch::load(const char *image, size_t size)
+{
+    for (auto &lane : lanes)
+    {
+        if (!lane->load(image, size))
+        {
+            return false;
+        }
+    }
+    analyze();
+    return true;
+}
+
+void m20::Batch::reset()
+{
+    for (size_t id = 0; id < lanes.size(); ++id)
+    {
+        lanes[id]->reset();
+        lanes[id]->getRegisters().r[0] = (int) id;
+    }
+    std::fill(statuses.begin(), statuses.end(), Status::RUNNING);
+    lockstep = 0;
+}
+
+void m20::Batch::run(size_t steps)
+{
+    std::vector<size_t> begin;
+    for (const auto &lane : lanes)
+    {
+        begin.push_back(lane->getInstructionsExecuted());
+    }
+
+    gather();
+    while (group.size() >= MIN_LANES && executed < steps && step())
+    {
+        //
+    }
+    dissolve();
+
+    // Lanes that left the group finish on their own engines
+    for (size_t id = 0; id < lanes.size(); ++id)
+    {
+        size_t done = lanes[id]->getInstructionsExecuted() - begin[id];
+        statuses[id] = lanes[id]->run(steps - std::min(done, steps));
+    }
+}
+
+size_t m20::Batch::getInstructionsExecuted() const
+{
+    size_t total = 0;
+    for (const auto &lane : lanes)
+    {
+        total += lane->getInstructionsExecuted();
+    }
+    return total;
+}
+
+void m20::Batch::simulate(std::ostream &out)
+{
+    reset();
+    auto begin = std::chrono::steady_clock::now();
+    run(SIZE_MAX);
+    double seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - begin).count();
+
+    for (size_t id = 0; id < lanes.size(); ++id)
+    {
+        out << "Lane " << std::dec << id << ": "
+            << getStatusName(statuses[id]) << " after "
+            << lanes[id]->getInstructionsExecuted() << " instructions, r0 = "
+            << lanes[id]->getRegisters().r[0] << "\n";
+    }
+
+    size_t total = getInstructionsExecuted();
+    double share = total > 0 ? 100.0 * lockstep / total : 0;
+    double mips = seconds > 0 ? total / seconds / 1e6 : 0;
+    out << "Executed " << total << " instructions in " << lanes.size()
+        << " lanes, " << std::fixed << std::setprecision(1) << share
+        << "% in lockstep" << std::endl;
+    out << "Wall time " << std::setprecision(3) << seconds << " s, "
+        << std::setprecision(2) << mips << " MIPS"
+        << std::defaultfloat << std::setprecision(6) << std::endl;
+}
+
+void m20::Batch::analyze()
+{
+    // Stores below the end of the discovered code may patch instructions
+    // the group has already fetched from its first lane only
+    codeEnd = 0;
+    for (const auto &i : lanes[0]->getControlFlowGraph().getBlocks())
+    {
+        codeEnd = std::max(codeEnd, i.second.end);
+    }
+}
+
+void m20::Batch::gather()
+{
+    group.clear();
+    executed = 0;
+    retired = 0;
+    for (unsigned int id = 0; id < lanes.size(); ++id)
+    {
+        const Simulator &sim = *lanes[id];
+        if (sim.isHalted())
+        {
+            continue;
+        }
+        if (group.empty())
+        {
+            pc = lanes[id]->getRegisters().pc;
+        }
+        if (lanes[id]->getRegisters().pc == pc)
+        {
+            group.push_back(id);
+            capture(group.size() - 1);
+        }
+    }
+}
+
+void m20::Batch::dissolve()
+{
+    while (!group.empty())
+    {
+        leave(group.size() - 1, pc, executed);
+    }
+}
+
+bool m20::Batch::step()
+{
+    char word[4];
+    if ((pc & 3) != 0 || pc < 0
+        || !lane(0).readMemory((unsigned int) pc, word, 4))
+    {
+        return false;   // The lanes' engines raise the prefetch abort
+    }
+
+    auto instr = (int) bytesToInt(word);
+    DecodedInstruction d = Decoder::decode(instr);
+    int next = pc + 4;
+    size_t n = group.size();
+
+    target = next;
+    diverged = false;
+    codeWritten = false;
+    std::fill(exits.begin(), exits.begin() + n, STAY);
+
+    bool vector = d.op != Op::GENERIC && d.op != Op::SWI && !touchesPc(d);
+    if (vector)
+    {
+        if (d.cond == COND_AL)
+        {
+            std::fill(passed.begin(), passed.begin() + n, 1);
+        }
+        else
+        {
+            const int *st = row(ST);
+            for (size_t k = 0; k < n; ++k)
+            {
+                passed[k] = Simulator::testCondition(st[k], d.cond);
+            }
+        }
+
+        switch (d.op)
+        {
+            case Op::B:
+            case Op::BWL:
+                executeBranch(d, next);
+                break;
+            case Op::PUSH:
+            case Op::POP:
+            case Op::LDR:
+            case Op::LDRB:
+            case Op::LDRH:
+            case Op::LDRSB:
+            case Op::LDRSH:
+            case Op::STR:
+            case Op::STRB:
+            case Op::STRH:
+                executeMemory(d, next);
+                break;
+            default:
+                vector = executeData(d);
+                break;
+        }
+    }
+    if (!vector)
+    {
+        executeLanes(instr, next);
+    }
+
+    settle();
+    return !codeWritten;
+}
+
+void m20::Batch::settle()
+{
+    size_t n = group.size();
+    if (!diverged)
+    {
+        pc = target;
+        ++executed;
+        lockstep += n;
+        return;
+    }
+
+    // The most common next PC keeps the group; ties go to the lower address
+    std::map<int, size_t> votes;
+    for (size_t k = 0; k < n; ++k)
+    {
+        if (exits[k] == STAY)
+        {
+            ++votes[targets[k]];
+        }
+    }
+    int majority = pc;
+    size_t best = 0;
+    for (const auto &vote : votes)
+    {
+        if (vote.second > best)
+        {
+            majority = vote.first;
+            best = vote.second;
+        }
+    }
+
+    // Leaving moves the last slot into k, which was already settled
+    for (size_t k = n; k-- > 0;)
+    {
+        if (exits[k] == BEFORE)
+        {
+            leave(k, pc, executed);
+            continue;
+        }
+        ++lockstep;
+        if (exits[k] == AFTER || targets[k] != majority)
+        {
+            leave(k, targets[k], executed + 1);
+        }
+    }
+    pc = majority;
+    ++executed;
+}
+
+void m20::Batch::diverge()
+{
+    if (!diverged)
+    {
+        std::fill(targets.begin(), targets.begin() + group.size(), target);
+        diverged = true;
+    }
+}
+
+void m20::Batch::leave(size_t slot, int address, size_t count)
+{
+    enter(slot, address);
+    lane(slot).retire(count - retired);
+
+    size_t last = group.size() - 1;
+    if (slot != last)
+    {
+        for (int reg = 0; reg < 16; ++reg)
+        {
+            row(reg)[slot] = row(reg)[last];
+        }
+        group[slot] = group[last];
+        banks[slot] = banks[last];
+        targets[slot] = targets[last];
+        exits[slot] = exits[last];
+        passed[slot] = passed[last];
+    }
+    group.pop_back();
+}
+
+void m20::Batch::enter(size_t slot, int address)
+{
+    Registers &r = lane(slot).getRegisters();
+    for (int reg = 0; reg < 13; ++reg)
+    {
+        r.r[reg] = row(reg)[slot];
+    }
+    r.sp[banks[slot]] = row(13)[slot];
+    r.lp[banks[slot]] = row(14)[slot];
+    r.st = row(ST)[slot];
+    r.pc = address;
+}
+
+void m20::Batch::capture(size_t slot)
+{
+    const Registers &r = lane(slot).getRegisters();
+    int bank = r.st & 3;
+    for (int reg = 0; reg < 13; ++reg)
+    {
+        row(reg)[slot] = r.r[reg];
+    }
+    row(13)[slot] = r.sp[bank];
+    row(14)[slot] = r.lp[bank];
+    row(ST)[slot] = r.st;
+    banks[slot] = bank;
+    targets[slot] = r.pc;
+}
+
+void m20::Batch::rebank(size_t slot)
+{
+    // A flag update changed the mode bits: swap in the new SP and LP
+    Registers &r = lane(slot).getRegisters();
+    r.sp[banks[slot]] = row(13)[slot];
+    r.lp[banks[slot]] = row(14)[slot];
+    banks[slot] = row(ST)[slot] & 3;
+    row(13)[slot] = r.sp[banks[slot]];
+    row(14)[slot] = r.lp[banks[slot]];
+}
+
+void m20::Batch::executeLanes(int instr, int next)
+{
+    // Each lane runs the instruction on its own simulator. A lane that
+    // aborts leaves before the instruction so its engine repeats the abort.
+    diverge();
+    for (size_t k = 0; k < group.size(); ++k)
+    {
+        Simulator &sim = lane(k);
+
+        // The instruction may read the lane's instruction counter
+        sim.retire(executed - retired);
+        enter(k, next);
+        try
+        {
+            sim.execute(instr);
+        }
+        catch (...)
+        {
+            exits[k] = BEFORE;
+            continue;
+        }
+        if (sim.clearException())
+        {
+            exits[k] = BEFORE;      // Raised without unwinding
+            continue;
+        }
+
+        capture(k);
+        if (sim.isHalted())
+        {
+            exits[k] = AFTER;
+        }
+    }
+    retired = executed;
+}
+
+bool m20::Batch::executeData(const DecodedInstruction &d)
+{
+    const int *rn = row(d.rn);
+    const int *rd = row(d.rd);
+
+    switch (d.op)
+    {
+        case Op::ADD:
+            compute(d, rn, getOperand(d), true, [](int a, int b, int)
+            {
+                return (long long) (a + b);
+            });
+            break;
+        case Op::ADC:
+            compute(d, rn, getOperand(d), true, [](int a, int b, int st)
+            {
+                return (long long) (a + b + ((st & ST_C) != 0 ? 1 : 0));
+            });
+            break;
+        case Op::SUB:
+            compute(d, rn, getOperand(d), true, [](int a, int b, int)
+            {
+                return (long long) (a - b);
+            });
+            break;
+        case Op::SBC:
+            compute(d, rn, getOperand(d), true, [](int a, int b, int st)
+            {
+                return (long long) (a - b - ((st & ST_C) == 0 ? 1 : 0));
+            });
+            break;
+        case Op::MUL:
+            compute(d, rn, getOperand(d), true, [](int a, int b, int)
+            {
+                return (long long) (a * b);
+            });
+            break;
+        case Op::OR:
+            compute(d, rn, getOperand(d), true, [](int a, int b, int)
+            {
+                return (long long) (a | b);
+            });
+            break;
+        case Op::AND:
+            compute(d, rn, getOperand(d), true, [](int a, int b, int)
+            {
+                return (long long) (a & b);
+            });
+            break;
+        case Op::XOR:
+            compute(d, rn, getOperand(d), true, [](int a, int b, int)
+            {
+                return (long long) (a ^ b);
+            });
+            break;
+        case Op::NOR:
+            compute(d, rn, getOperand(d), true, [](int a, int b, int)
+            {
+                return (long long) ~(a | b);
+            });
+            break;
+        case Op::BIC:
+            compute(d, rn, getOperand(d), true, [](int a, int b, int)
+            {
+                return (long long) (a & ~b);
+            });
+            break;
+        case Op::LSL:
+        {
+            // Shifts of 32 or more differ between host instructions
+            const int *b = getOperand(d);
+            for (size_t k = 0; k < group.size(); ++k)
+            {
+                if ((unsigned int) b[k] > 31)
+                {
+                    return false;
+                }
+            }
+            compute(d, rn, b, true, [](int a, int b, int)
+            {
+                return (long long) (a << b);
+            });
+            break;
+        }
+        case Op::MOV:
+            compute(d, getOperand(d), zeros.data(), true, [](int a, int, int)
+            {
+                return (long long) a;
+            });
+            break;
+        case Op::MVN:
+            compute(d, getOperand(d), zeros.data(), true, [](int a, int, int)
+            {
+                return (long long) ~a;
+            });
+            break;
+        case Op::CMP:
+            compute(d, rd, getOperand(d), false, [](int a, int b, int)
+            {
+                return (long long) (a - b);
+            });
+            break;
+        case Op::CMN:
+            compute(d, rd, getOperand(d), false, [](int a, int b, int)
+            {
+                return (long long) (a + b);
+            });
+            break;
+        case Op::TST:
+            compute(d, rd, getOperand(d), false, [](int a, int b, int)
+            {
+                return (long long) (a & b);
+            });
+            break;
+        case Op::TEQ:
+            compute(d, rd, getOperand(d), false, [](int a, int b, int)
+            {
+                return (long long) (a ^ b);
+            });
+            break;
+        default:
+            return false;   // Division and rotates
+    }
+    return true;
+}
+
+template <typename F>
+void m20::Batch::compute(const DecodedInstruction &d, const int *a,
+                         const int *b, bool write, F f)
+{
+    size_t n = group.size();
+    int *rd = row(d.rd);
+    int *st = row(ST);
+    const uint8_t *p = passed.data();
+
+    // Branch-free over lanes: failed conditions keep the old values
+    if (d.update)
+    {
+        for (size_t k = 0; k < n; ++k)
+        {
+            int x = a[k];
+            int y = b[k];
+            int s = st[k];
+            long long v = f(x, y, s);
+            if (write)
+            {
+                rd[k] = p[k] ? (int) v : rd[k];
+            }
+            st[k] = p[k] ? Simulator::nextStatus(s, v, x, y) : s;
+        }
+        for (size_t k = 0; k < n; ++k)
+        {
+            if ((st[k] & 3) != banks[k])
+            {
+                rebank(k);
+            }
+        }
+    }
+    else if (write)
+    {
+        for (size_t k = 0; k < n; ++k)
+        {
+            int v = (int) f(a[k], b[k], st[k]);
+            rd[k] = p[k] ? v : rd[k];
+        }
+    }
+}
+
+void m20::Batch::executeMemory(const DecodedInstruction &d, int next)
+{
+    size_t n = group.size();
+    const uint8_t *p = passed.data();
+    int *rd = row(d.rd);
+    int *sp = row(13);
+
+    if (d.op == Op::PUSH)
+    {
+        const int *value = getOperand(d);
+        for (size_t k = 0; k < n; ++k)
+        {
+            if (!p[k])
+            {
+                continue;
+            }
+            // push sp stores the decremented SP, as on the simulator
+            sp[k] -= 4;
+            try
+            {
+                lane(k).storeWord(sp[k], value[k]);
+            }
+            catch (const DataAbortException &e)
+            {
+                sp[k] += 4;
+                diverge();
+                exits[k] = BEFORE;
+                continue;
+            }
+            stored(sp[k]);
+        }
+        updateStack(d);
+        return;
+    }
+    if (d.op == Op::POP)
+    {
+        int *value = row(d.rm);
+        for (size_t k = 0; k < n; ++k)
+        {
+            if (!p[k])
+            {
+                continue;
+            }
+            try
+            {
+                value[k] = lane(k).loadWord(sp[k]);
+            }
+            catch (const DataAbortException &e)
+            {
+                diverge();
+                exits[k] = BEFORE;
+                continue;
+            }
+            sp[k] += 4;
+        }
+        updateStack(d);
+        return;
+    }
+
+    const int *rn = row(d.rn);
+    const int *rm = row(d.rm);
+    for (size_t k = 0; k < n; ++k)
+    {
+        if (!p[k])
+        {
+            continue;
+        }
+
+        int addr;
+        switch (d.address)
+        {
+            case Address::BASE_IMMEDIATE:
+                addr = rn[k] + d.imm;
+                break;
+            case Address::BASE_REGISTER:
+                addr = rn[k] + rm[k];
+                break;
+            case Address::PC_IMMEDIATE:
+                addr = next + d.imm;
+                break;
+            default:
+                addr = rm[k];
+                break;
+        }
+
+        Simulator &sim = lane(k);
+        try
+        {
+            switch (d.op)
+            {
+                case Op::LDR:
+                    rd[k] = sim.loadWord(addr);
+                    break;
+                case Op::LDRB:
+                    rd[k] = (int) ((unsigned int) sim.loadByte(addr));
+                    break;
+                case Op::LDRH:
+                    rd[k] = (int) ((unsigned int) sim.loadHalfword(addr));
+                    break;
+                case Op::LDRSB:
+                    rd[k] = sim.loadByte(addr);
+                    break;
+                case Op::LDRSH:
+                    rd[k] = sim.loadHalfword(addr);
+                    break;
+                case Op::STR:
+                    sim.storeWord(addr, rd[k]);
+                    stored(addr);
+                    break;
+                case Op::STRB:
+                    sim.storeByte(addr, rd[k]);
+                    stored(addr);
+                    break;
+                default:    // STRH
+                    sim.storeHalfword(addr, rd[k]);
+                    stored(addr);
+                    break;
+            }
+        }
+        catch (const DataAbortException &e)
+        {
+            diverge();
+            exits[k] = BEFORE;
+        }
+    }
+}
+
+void m20::Batch::updateStack(const DecodedInstruction &d)
+{
+    if (!d.update)
+    {
+        return;
+    }
+
+    // As on the simulator, push.s and pop.s update st as for a zero result;
+    // lanes that abort leave before the instruction and keep their st
+    size_t n = group.size();
+    int *st = row(ST);
+    const uint8_t *p = passed.data();
+    for (size_t k = 0; k < n; ++k)
+    {
+        if (p[k] && exits[k] != BEFORE)
+        {
+            st[k] = Simulator::nextStatus(st[k], 0, 0, 0);
+        }
+    }
+}
+
+void m20::Batch::executeBranch(const DecodedInstruction &d, int next)
+{
+    size_t n = group.size();
+    const uint8_t *p = passed.data();
+    int *lp = row(14);
+    bool link = d.op == Op::BWL;
+
+    if (d.immediate)
+    {
+        auto taken = (size_t) std::count(p, p + n, 1);
+        if (taken == 0)
+        {
+            return;
+        }
+        if (taken == n)
+        {
+            if (link)
+            {
+                std::fill(lp, lp + n, next);
+            }
+            target = next + d.imm;
+            return;
+        }
+    }
+
+    // Link before reading the target, which may be LP
+    diverge();
+    const int *rm = row(d.rm);
+    for (size_t k = 0; k < n; ++k)
+    {
+        if (p[k])
+        {
+            if (link)
+            {
+                lp[k] = next;
+            }
+            targets[k] = d.immediate ? next + d.imm : rm[k];
+        }
+    }
+}
+
+const int *m20::Batch::getOperand(const DecodedInstruction &d)
+{
+    if (!d.immediate)
+    {
+        return row(d.rm);
+    }
+    std::fill(operands.begin(), operands.begin() + group.size(), d.imm);
+    return operands.data();
+}
+
+void m20::Batch::stored(int addr)
+{
+    if ((unsigned int) addr < codeEnd)
+    {
+        codeWritten = true;
+    }
+}
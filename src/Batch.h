@@ -0,0 +1,178 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Lockstep batch execution of many instances of one program.
+ * =============================================================================
+ */
+
+#ifndef M20_ASSEMBLY_BATCH_H
+#define M20_ASSEMBLY_BATCH_H
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Decoder.h"
+#include "Simulator.h"
+
+namespace m20
+{
+    /**
+     * Runs N instances (lanes) of one executable for parameter sweeps. Each
+     *  lane is a Simulator with its own memory and starts with its lane
+     *  number in r0.
+     *
+     * While lanes agree on the PC they form a group whose registers are kept
+     *  as a structure of arrays, one row per register, and every instruction
+     *  is decoded once and executed by loops over the lanes. Conditional
+     *  instructions are masked per lane. Instructions without a lockstep
+     *  form (status registers, interrupts, division, rotates, anything
+     *  touching PC but a branch) run lane by lane on the lanes' own
+     *  simulators without leaving the group.
+     *
+     * A lane leaves the group when its next PC differs from the majority's,
+     *  when it halts or aborts, and all lanes leave once fewer than
+     *  MIN_LANES remain or a store lands in the image's code. Lanes that
+     *  left finish on their own engine and do not rejoin. BIOS output is
+     *  discarded.
+     */
+    class Batch
+    {
+    public:
+        static const unsigned int MAX_LANES = 256;
+        static const size_t MIN_LANES = 2;
+
+        /**
+         * @param memorySize Size of each lane's guest memory in bytes
+         * @param count Number of lanes, 1 to MAX_LANES
+         */
+        Batch(size_t memorySize, unsigned int count);
+
+        Simulator &getLane(unsigned int id)
+        {
+            return *lanes[id];
+        }
+
+        unsigned int getLaneCount() const
+        {
+            return (unsigned int) lanes.size();
+        }
+
+        bool load(const std::string &fname);
+
+        bool load(const char *image, size_t size);
+
+        /**
+         * Resets every lane and sets r0 of lane i to i
+         */
+        void reset();
+
+        /**
+         * Runs every lane until it stops or has executed steps more
+         *  instructions
+         */
+        void run(size_t steps);
+
+        /**
+         * Returns the status of a lane after run()
+         */
+        Status getStatus(unsigned int id) const
+        {
+            return statuses[id];
+        }
+
+        /**
+         * Returns the instructions executed by all lanes since reset
+         */
+        size_t getInstructionsExecuted() const;
+
+        /**
+         * Returns how many of those were executed in lockstep
+         */
+        size_t getLockstepInstructions() const
+        {
+            return lockstep;
+        }
+
+        /**
+         * Resets and runs all lanes, then prints a line per lane (status,
+         *  instructions, r0) and the share of instructions run in lockstep
+         */
+        void simulate(std::ostream &out = std::cout);
+
+    private:
+        static const int ST = 15;       // Row of the status register
+
+        /**
+         * What happens to a lane at the end of a lockstep instruction
+         */
+        enum Exit : uint8_t
+        {
+            STAY,
+            BEFORE,         // Leaves before the instruction (to abort)
+            AFTER           // Leaves after it (halted)
+        };
+
+        std::ostream discard;
+        std::vector<std::unique_ptr<Simulator>> lanes;
+        std::vector<Status> statuses;
+        unsigned int codeEnd;
+        size_t lockstep;
+
+        // Lockstep group; slot k holds lane group[k]
+        std::vector<unsigned int> group;
+        std::vector<int> file;          // 16 rows of one int per lane
+        std::vector<int> banks;         // Register bank (mode) per slot
+        std::vector<int> targets;       // Next PC per slot
+        std::vector<int> operands;
+        std::vector<int> zeros;
+        std::vector<uint8_t> passed;    // Condition held per slot
+        std::vector<uint8_t> exits;
+        int pc;
+        int target;                     // Next PC while no slot diverged
+        size_t executed;                // Lockstep instructions this run
+        size_t retired;                 // Of those, counted on the lanes
+        bool diverged;                  // Slots have their own targets
+        bool codeWritten;
+
+        int *row(int reg)
+        {
+            return file.data() + (size_t) reg * lanes.size();
+        }
+
+        Simulator &lane(size_t slot)
+        {
+            return *lanes[group[slot]];
+        }
+
+        void analyze();
+        void gather();
+        void dissolve();
+        bool step();
+        void settle();
+        void diverge();
+        void leave(size_t slot, int address, size_t count);
+        void enter(size_t slot, int address);
+        void capture(size_t slot);
+        void rebank(size_t slot);
+
+        void executeLanes(int instr, int next);
+        bool executeData(const DecodedInstruction &d);
+        void executeMemory(const DecodedInstruction &d, int next);
+        void updateStack(const DecodedInstruction &d);
+        void executeBranch(const DecodedInstruction &d, int next);
+        const int *getOperand(const DecodedInstruction &d);
+        void stored(int addr);
+
+        template <typename F>
+        void compute(const DecodedInstruction &d, const int *a,
+                     const int *b, bool write, F f);
+    };
+}
+
+#endif // M20_ASSEMBLY_BATCH_H
@@ -0,0 +1,268 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Call-graph profile of a simulator run from a shadow call stack.
+ *      (Implementation)
+ * =============================================================================
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+#include "CallGraph.h"
+#include "Decoder.h"
+
+namespace
+{
+    const size_t MAX_ROWS = 20;
+}
+
+void m20::CallGraph::clear(unsigned int entry)
+{
+    functions.clear();
+    ids.clear();
+    frames.clear();
+    executed = 0;
+    next = entry;
+    lastPc = entry;
+    last = 0;
+
+    size_t root = getFunction(entry);
+    functions[root].calls = 1;
+    functions[root].active = 1;
+    frames.push_back({root, entry, entry, 0});
+}
+
+void m20::CallGraph::close()
+{
+    while (frames.size() > 1)
+    {
+        leave();
+    }
+    Function &root = functions[frames.back().function];
+    root.inclusive = executed - frames.back().entered;
+}
+
+void m20::CallGraph::print(std::ostream &os, const SymbolMap &symbols) const
+{
+    std::vector<size_t> order(functions.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+    {
+        return functions[a].inclusive > functions[b].inclusive;
+    });
+
+    double total = std::max(executed, (size_t) 1);
+    os << "Call Graph ---------------------\n"
+       << std::dec << executed << " instructions in " << functions.size()
+       << " functions\n"
+       << "  " << std::left << std::setw(24) << std::setfill(' ')
+       << "function" << std::right << std::setw(19) << "inclusive"
+       << std::setw(19) << "exclusive" << std::setw(10) << "calls\n";
+    for (size_t i = 0; i < order.size() && i < MAX_ROWS; ++i)
+    {
+        const Function &function = functions[order[i]];
+        size_t exclusive = getExclusive(function);
+        os << "  " << std::left << std::setw(24)
+           << getName(function, symbols) << std::right << std::fixed
+           << std::setprecision(1) << std::setw(10) << function.inclusive
+           << " (" << std::setw(5) << 100.0 * function.inclusive / total
+           << "%)" << std::setw(10) << exclusive << " ("
+           << std::setw(5) << 100.0 * exclusive / total << "%)"
+           << std::setw(9) << function.calls << "\n";
+    }
+
+    // Calls per caller by inclusive cost, so shared routines show who pays
+    // for them
+    struct Row
+    {
+        size_t caller;
+        size_t callee;
+        Call call;
+    };
+    std::map<std::pair<size_t, size_t>, Call> edges;
+    for (size_t i = 0; i < functions.size(); ++i)
+    {
+        for (const auto &callee : functions[i].callees)
+        {
+            Call &edge = edges[{i, callee.first.second}];
+            edge.count += callee.second.count;
+            edge.inclusive += callee.second.inclusive;
+        }
+    }
+    std::vector<Row> calls;
+    for (const auto &edge : edges)
+    {
+        calls.push_back({edge.first.first, edge.first.second, edge.second});
+    }
+    std::stable_sort(calls.begin(), calls.end(),
+                     [](const Row &a, const Row &b)
+                     {
+                         return a.call.inclusive > b.call.inclusive;
+                     });
+
+    os << "  " << std::left << std::setw(43) << "call" << std::right
+       << std::setw(19) << "inclusive" << std::setw(10) << "calls\n";
+    for (size_t i = 0; i < calls.size() && i < MAX_ROWS; ++i)
+    {
+        const Row &row = calls[i];
+        std::string edge = getName(functions[row.caller], symbols) + " -> "
+                           + getName(functions[row.callee], symbols);
+        os << "  " << std::left << std::setw(43) << edge << std::right
+           << std::setw(10) << row.call.inclusive << " (" << std::setw(5)
+           << 100.0 * row.call.inclusive / total << "%)" << std::setw(9)
+           << row.call.count << "\n";
+    }
+    os << std::defaultfloat << std::setprecision(6)
+       << "--------------------------------" << std::endl;
+}
+
+void m20::CallGraph::writeCallgrind(std::ostream &os,
+                                    const SymbolMap &symbols,
+                                    const std::string &command) const
+{
+    os << "# callgrind format\n"
+       << "version: 1\n"
+       << "creator: m20 simulate\n"
+       << "cmd: " << command << "\n"
+       << "positions: instr\n"
+       << "events: Ir\n"
+       << "summary: " << std::dec << executed << "\n\n"
+       << "fl=(1) " << command << "\n";
+
+    // Names are compressed to "(id)" after their first use
+    std::set<size_t> named;
+    auto name = [&](size_t id) -> std::string
+    {
+        std::ostringstream ss;
+        ss << "(" << id + 1 << ")";
+        if (named.insert(id).second)
+        {
+            ss << " " << getName(functions[id], symbols);
+        }
+        return ss.str();
+    };
+
+    os << std::hex;
+    for (size_t i = 0; i < functions.size(); ++i)
+    {
+        const Function &function = functions[i];
+        os << "\nfn=" << name(i) << "\n";
+
+        std::map<unsigned int, size_t> lines(function.self.begin(),
+                                             function.self.end());
+        for (const auto &line : lines)
+        {
+            os << "0x" << line.first << " " << std::dec << line.second
+               << std::hex << "\n";
+        }
+        for (const auto &callee : function.callees)
+        {
+            os << "cfn=" << name(callee.first.second) << "\n"
+               << "calls=" << std::dec << callee.second.count << std::hex
+               << " 0x" << functions[callee.first.second].entry << "\n"
+               << "0x" << callee.first.first << " " << std::dec
+               << callee.second.inclusive << std::hex << "\n";
+        }
+    }
+    os << std::dec << std::flush;
+}
+
+void m20::CallGraph::transfer(unsigned int pc)
+{
+    DecodedInstruction d = Decoder::decode(last);
+    if ((d.op == Op::BWL || d.op == Op::SWI) && frames.size() < MAX_DEPTH)
+    {
+        call(pc);
+        return;
+    }
+    if (d.op == Op::B && d.immediate)
+    {
+        return;     // Direct branches stay in the function
+    }
+
+    for (size_t i = frames.size(); i-- > 1;)
+    {
+        if (frames[i].returnAddress == pc)
+        {
+            while (frames.size() > i)
+            {
+                leave();
+            }
+            return;
+        }
+    }
+}
+
+void m20::CallGraph::call(unsigned int target)
+{
+    size_t caller = frames.back().function;
+    size_t callee = getFunction(target);
+
+    Call &edge = functions[caller].callees[{lastPc, callee}];
+    ++edge.count;
+    ++functions[callee].calls;
+    ++functions[callee].active;
+    frames.push_back({callee, lastPc, lastPc + 4, executed});
+}
+
+void m20::CallGraph::leave()
+{
+    Frame frame = frames.back();
+    frames.pop_back();
+
+    // Only the outermost open frame of a function counts, so recursion
+    // does not count the same instructions twice
+    Function &callee = functions[frame.function];
+    if (--callee.active == 0)
+    {
+        size_t inclusive = executed - frame.entered;
+        callee.inclusive += inclusive;
+        functions[frames.back().function]
+                .callees[{frame.site, frame.function}].inclusive += inclusive;
+    }
+}
+
+size_t m20::CallGraph::getFunction(unsigned int entry)
+{
+    auto i = ids.find(entry);
+    if (i != ids.end())
+    {
+        return i->second;
+    }
+
+    Function function = {};
+    function.entry = entry;
+    functions.push_back(function);
+    ids[entry] = functions.size() - 1;
+    return functions.size() - 1;
+}
+
+size_t m20::CallGraph::getExclusive(const Function &function) const
+{
+    size_t exclusive = 0;
+    for (const auto &line : function.self)
+    {
+        exclusive += line.second;
+    }
+    return exclusive;
+}
+
+std::string m20::CallGraph::getName(const Function &function,
+                                    const SymbolMap &symbols) const
+{
+    const SymbolMap::Entry *entry = symbols.find(function.entry);
+    if (entry != nullptr && entry->address == function.entry)
+    {
+        return entry->name;
+    }
+    return symbols.describe(function.entry);
+}
@@ -0,0 +1,133 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Call-graph profile of a simulator run from a shadow call stack.
+ * =============================================================================
+ */
+
+#ifndef M20_ASSEMBLY_CALLGRAPH_H
+#define M20_ASSEMBLY_CALLGRAPH_H
+
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "SymbolMap.h"
+
+namespace m20
+{
+    /**
+     * Attributes executed instructions to guest functions. A shadow call
+     *  stack follows the calling convention: a taken bwl (or an swi that
+     *  enters the kernel) pushes a frame for its target, and a jump to the
+     *  return address of an open frame (mov pc, lp, pop pc, ...) returns
+     *  from it and every frame above it. Other jumps stay in the function.
+     *
+     * Each instruction counts exclusively to the function of the top frame.
+     *  A return adds the instructions since the call inclusively to the
+     *  function and the call site, unless the function is still open
+     *  further down (recursion).
+     */
+    class CallGraph
+    {
+    public:
+        static const size_t MAX_DEPTH = 4096;
+
+        CallGraph()
+        {
+            clear();
+        }
+
+        /**
+         * Forgets every function and opens the root frame at entry
+         */
+        void clear(unsigned int entry = 0);
+
+        /**
+         * Records one executed instruction
+         * @param pc Address of the instruction
+         * @param instr Instruction word
+         */
+        void execute(unsigned int pc, int instr)
+        {
+            if (pc != next)
+            {
+                transfer(pc);
+            }
+            ++functions[frames.back().function].self[pc];
+            ++executed;
+            last = instr;
+            lastPc = pc;
+            next = pc + 4;
+        }
+
+        /**
+         * Returns from every open frame but the root, as if the run ended
+         *  there
+         */
+        void close();
+
+        /**
+         * Prints the functions by inclusive cost and the costliest calls
+         */
+        void print(std::ostream &os, const SymbolMap &symbols) const;
+
+        /**
+         * Writes the profile in callgrind format, one cost line per
+         *  instruction address
+         * @param command Command line recorded in the profile
+         */
+        void writeCallgrind(std::ostream &os, const SymbolMap &symbols,
+                            const std::string &command) const;
+
+    private:
+        struct Call
+        {
+            size_t count;
+            size_t inclusive;
+        };
+
+        struct Function
+        {
+            unsigned int entry;
+            size_t calls;
+            size_t inclusive;
+            size_t active;          // Open frames of the function
+            std::unordered_map<unsigned int, size_t> self;
+            std::map<std::pair<unsigned int, size_t>, Call> callees;
+        };
+
+        struct Frame
+        {
+            size_t function;
+            unsigned int site;              // Address of the call
+            unsigned int returnAddress;
+            size_t entered;                 // Instructions before the call
+        };
+
+        std::vector<Function> functions;
+        std::unordered_map<unsigned int, size_t> ids;   // Entry to function
+        std::vector<Frame> frames;
+        size_t executed;
+        unsigned int next;
+        unsigned int lastPc;
+        int last;
+
+        void transfer(unsigned int pc);
+        void call(unsigned int target);
+        void leave();
+        size_t getFunction(unsigned int entry);
+        size_t getExclusive(const Function &function) const;
+        std::string getName(const Function &function,
+                            const SymbolMap &symbols) const;
+    };
+}
+
+#endif // M20_ASSEMBLY_CALLGRAPH_H
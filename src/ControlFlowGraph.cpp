@@ -0,0 +1,295 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Static control-flow graph discovery for M20 executable images.
+ *      (Implementation)
+ * =============================================================================
+ */
+
+#include <iomanip>
+
+#include "ControlFlowGraph.h"
+#include "Decoder.h"
+#include "Simulator.h"
+#include "Utils.h"
+
+void m20::ControlFlowGraph::build(const char *image, size_t size,
+                                  unsigned int entry)
+{
+    this->image = image;
+    this->size = size;
+    blocks.clear();
+    functions.clear();
+
+    std::set<unsigned int> leaders;
+    std::set<unsigned int> code;
+    std::vector<unsigned int> work;
+
+    if (isCode(entry))
+    {
+        leaders.insert(entry);
+        functions.insert(entry);
+        work.push_back(entry);
+    }
+
+    // Explore every path reachable through direct control flow
+    while (!work.empty())
+    {
+        unsigned int address = work.back();
+        work.pop_back();
+
+        while (isCode(address) && code.insert(address).second)
+        {
+            Exit exit = classify(address);
+            for (const auto &target : exit.targets)
+            {
+                if (isCode(target))
+                {
+                    leaders.insert(target);
+                    work.push_back(target);
+                }
+            }
+            for (const auto &call : exit.calls)
+            {
+                if (isCode(call))
+                {
+                    leaders.insert(call);
+                    functions.insert(call);
+                    work.push_back(call);
+                }
+            }
+
+            if (exit.branch)
+            {
+                if (!exit.fallthrough)
+                {
+                    break;
+                }
+                leaders.insert(address + 4);
+            }
+            address += 4;
+        }
+    }
+
+    // Split the discovered instructions into blocks at every leader
+    BasicBlock *current = nullptr;
+    for (const auto &address : code)
+    {
+        if (current != nullptr
+            && (current->end != address || leaders.count(address) != 0))
+        {
+            if (current->end == address)
+            {
+                current->successors.push_back(address);
+            }
+            current = nullptr;
+        }
+        if (current == nullptr)
+        {
+            current = &blocks.emplace(address, BasicBlock(address))
+                    .first->second;
+        }
+
+        current->end = address + 4;
+
+        Exit exit = classify(address);
+        current->calls.insert(current->calls.end(),
+                              exit.calls.begin(), exit.calls.end());
+        if (exit.branch)
+        {
+            for (const auto &target : exit.targets)
+            {
+                if (isCode(target))
+                {
+                    current->successors.push_back(target);
+                }
+            }
+            if (exit.fallthrough && isCode(address + 4))
+            {
+                current->successors.push_back(address + 4);
+            }
+            current->indirect = exit.indirect;
+            current = nullptr;
+        }
+    }
+}
+
+const m20::BasicBlock *m20::ControlFlowGraph::findBlock(
+        unsigned int address) const
+{
+    auto i = blocks.upper_bound(address);
+    if (i == blocks.begin())
+    {
+        return nullptr;
+    }
+    --i;
+    return address < i->second.end ? &i->second : nullptr;
+}
+
+unsigned int m20::ControlFlowGraph::findFunction(unsigned int address) const
+{
+    auto i = functions.upper_bound(address);
+    if (i == functions.begin())
+    {
+        return 0;
+    }
+    return *--i;
+}
+
+void m20::ControlFlowGraph::print(std::ostream &os) const
+{
+    os << "Control Flow Graph -------------\n";
+    os << std::dec << blocks.size() << " blocks, "
+       << functions.size() << " functions\n";
+    os << std::hex << std::setfill('0');
+
+    for (const auto &i : blocks)
+    {
+        const BasicBlock &block = i.second;
+        if (functions.count(block.begin) != 0)
+        {
+            os << "\n<0x" << std::setw(8) << block.begin << ">:\n";
+        }
+
+        os << "  0x" << std::setw(8) << block.begin
+           << "-0x" << std::setw(8) << block.end;
+        if (!block.successors.empty())
+        {
+            os << "  ->";
+            for (const auto &s : block.successors)
+            {
+                os << " 0x" << std::setw(8) << s;
+            }
+        }
+        for (const auto &c : block.calls)
+        {
+            os << "  call 0x" << std::setw(8) << c;
+        }
+        if (block.indirect)
+        {
+            os << "  (indirect)";
+        }
+        os << "\n";
+    }
+    os << "--------------------------------" << std::dec << std::setfill(' ')
+       << std::endl;
+}
+
+bool m20::ControlFlowGraph::isCode(unsigned int address) const
+{
+    return address % 4 == 0 && (size_t) address + 4 <= size;
+}
+
+m20::ControlFlowGraph::Exit m20::ControlFlowGraph::classify(
+        unsigned int address) const
+{
+    static const int COND_AL = 0xE;
+    static const int HALT_MASK = 0x09F00000;
+    static const int HALT = 0x01F00000;
+    static const int ATOMIC_MASK = 0x0C8F0000;
+    static const int ATOMIC_PC = 0x088F0000;
+
+    Exit exit;
+    auto instr = (int) bytesToInt(image + address);
+    DecodedInstruction d = Decoder::decode(instr);
+    bool always = d.cond == COND_AL;
+    unsigned int next = address + 4;
+
+    switch (d.op)
+    {
+        case Op::B:
+        case Op::BWL:
+            exit.branch = true;
+            if (!d.immediate)
+            {
+                exit.indirect = true;
+            }
+            else if (d.op == Op::BWL)
+            {
+                exit.calls.push_back(next + d.imm);
+            }
+            else
+            {
+                exit.targets.push_back(next + d.imm);
+            }
+            exit.fallthrough = d.op == Op::BWL || !always;
+            break;
+        case Op::SWI:
+            // Vector 0 enters the kernel through the vector table
+            if (d.imm == 0x00)
+            {
+                exit.branch = true;
+                exit.fallthrough = !always;
+                exit.targets.push_back(SoftwareInterruptException::INDEX);
+            }
+            break;
+        case Op::ADD: case Op::ADC: case Op::SUB: case Op::SBC:
+        case Op::MUL: case Op::DIV: case Op::UDV: case Op::OR:
+        case Op::AND: case Op::XOR: case Op::NOR: case Op::BIC:
+        case Op::ROR: case Op::LSL: case Op::MOV: case Op::MVN:
+            if (d.rd == 15)
+            {
+                exit.branch = true;
+                exit.indirect = true;
+                exit.fallthrough = !always;
+            }
+            break;
+        case Op::POP:
+            if (d.rm == 15)
+            {
+                exit.branch = true;
+                exit.indirect = true;
+                exit.fallthrough = !always;
+            }
+            break;
+        case Op::LDR:
+        case Op::LDRB:
+        case Op::LDRH:
+        case Op::LDRSB:
+        case Op::LDRSH:
+            if (d.rd == 15)
+            {
+                exit.branch = true;
+                exit.indirect = true;
+                exit.fallthrough = !always;
+
+                // Literal pool load (ldr pc, pc, #imm): follow the literal
+                bool literal = d.address == Address::PC_IMMEDIATE
+                               || (d.address == Address::BASE_IMMEDIATE
+                                   && d.rn == 15);
+                unsigned int pool = next + d.imm;
+                if (d.op == Op::LDR && literal && isCode(pool))
+                {
+                    exit.targets.push_back(bytesToInt(image + pool));
+                }
+            }
+            break;
+        case Op::GENERIC:
+            if ((instr & 0xF0000000) == 0xF0000000)
+            {
+                // Undefined condition
+                exit.branch = true;
+                exit.fallthrough = false;
+            }
+            else if ((instr & HALT_MASK) == HALT)
+            {
+                exit.branch = true;
+                exit.fallthrough = (instr & 0xF0000000) != 0xE0000000;
+            }
+            else if ((instr & ATOMIC_MASK) == ATOMIC_PC)
+            {
+                // swp, ldrex or strex into pc
+                exit.branch = true;
+                exit.indirect = true;
+                exit.fallthrough = ((unsigned int) instr >> 28) != COND_AL;
+            }
+            break;
+        default:
+            break;
+    }
+
+    return exit;
+}
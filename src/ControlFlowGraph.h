@@ -0,0 +1,113 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Static control-flow graph discovery for M20 executable images.
+ * =============================================================================
+ */
+
+#ifndef M20_ASSEMBLY_CONTROLFLOWGRAPH_H
+#define M20_ASSEMBLY_CONTROLFLOWGRAPH_H
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace m20
+{
+    /**
+     * Straight-line run of instructions with a single entry and exit
+     */
+    struct BasicBlock
+    {
+        unsigned int begin;     // Address of first instruction
+        unsigned int end;       // Address following the last instruction
+        bool indirect;          // Exits through a jump resolved at runtime
+        std::vector<unsigned int> successors;
+        std::vector<unsigned int> calls;
+
+        BasicBlock(unsigned int begin)
+            : begin(begin),
+              end(begin),
+              indirect(false)
+        {
+            //
+        }
+    };
+
+    /**
+     * Control-flow graph of an executable image, discovered by following
+     *  direct branches from the entry point. BWL targets are recorded as
+     *  likely function entries; literal loads into PC (as used by interrupt
+     *  vector tables) are followed through the word they load.
+     */
+    class ControlFlowGraph
+    {
+    public:
+        ControlFlowGraph() = default;
+
+        /**
+         * Discovers the basic blocks reachable from entry
+         * @param image Executable image (big endian instruction words)
+         * @param size Size of image in bytes
+         * @param entry Address execution starts at
+         */
+        void build(const char *image, size_t size, unsigned int entry);
+
+        /**
+         * Returns all basic blocks, keyed by their first address
+         */
+        const std::map<unsigned int, BasicBlock> &getBlocks() const
+        {
+            return blocks;
+        }
+
+        /**
+         * Returns the likely function entries (the entry point and all
+         *  BWL targets)
+         */
+        const std::set<unsigned int> &getFunctions() const
+        {
+            return functions;
+        }
+
+        /**
+         * Returns the block containing address, or nullptr
+         */
+        const BasicBlock *findBlock(unsigned int address) const;
+
+        /**
+         * Returns the nearest function entry at or below address
+         */
+        unsigned int findFunction(unsigned int address) const;
+
+        /**
+         * Prints the graph grouped by function
+         */
+        void print(std::ostream &os) const;
+
+    private:
+        struct Exit
+        {
+            bool branch = false;        // Ends the basic block
+            bool fallthrough = true;    // May continue to the next word
+            bool indirect = false;
+            std::vector<unsigned int> targets;
+            std::vector<unsigned int> calls;
+        };
+
+        const char *image = nullptr;
+        size_t size = 0;
+
+        std::map<unsigned int, BasicBlock> blocks;
+        std::set<unsigned int> functions;
+
+        bool isCode(unsigned int address) const;
+        Exit classify(unsigned int address) const;
+    };
+}
+
+#endif // M20_ASSEMBLY_CONTROLFLOWGRAPH_H
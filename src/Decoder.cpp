@@ -0,0 +1,547 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Instruction predecoder and superinstruction fusion for the M20
+ *      simulator. (Implementation)
+ * =============================================================================
+ */
+
+#include <sstream>
+
+#include "Decoder.h"
+
+namespace
+{
+    const int DATA_SIGNATURE = 0x08000000;
+    const int LOAD_SIGNATURE = 0x04000000;
+    const int BRANCH_SIGNATURE = 0x02000000;
+    const int COPROC_SIGNATURE = 0x01000000;
+
+    const uint8_t COND_AL = 0xE;
+    const uint8_t COND_INVALID = 0xF;
+
+    int signExtend(int value, int bits)
+    {
+        int sign = 1 << (bits - 1);
+        int mask = (int) (0xFFFFFFFF << (unsigned) bits);
+        return (value & sign) != 0 ? (value | mask) : value;
+    }
+
+    bool isRegisterIndex(int index)
+    {
+        return index >= 0 && index <= 15;
+    }
+
+    const char *const CONDITION_NAMES[] = {
+            "eq", "ne", "cs", "cc", "mi", "pl", "vs", "vc",
+            "hi", "ls", "ge", "lt", "gt", "le", "", ""
+    };
+
+    const char *const STATUS_NAMES[] = {"st", "sv", "ic", "ich", "cid", "ipi",
+                                        "far"};
+
+    std::string registerName(int reg)
+    {
+        static const char *const NAMES[] = {"sp", "lp", "pc"};
+        if (reg >= 13 && reg <= 15)
+        {
+            return NAMES[reg - 13];
+        }
+        return "r" + std::to_string(reg);
+    }
+
+    std::string statusName(int reg)
+    {
+        return reg >= 0 && reg <= 6 ? STATUS_NAMES[reg]
+                                    : "s" + std::to_string(reg);
+    }
+
+    std::string hex(unsigned int value)
+    {
+        std::ostringstream ss;
+        ss << "0x" << std::hex << value;
+        return ss.str();
+    }
+
+    m20::DecodedInstruction generic(int instr)
+    {
+        m20::DecodedInstruction d = {};
+        d.op = m20::Op::GENERIC;
+        d.fusion = m20::Fusion::NONE;
+        d.cond = COND_AL;
+        d.length = 1;
+        d.raw = instr;
+        return d;
+    }
+}
+
+m20::DecodedInstruction m20::Decoder::decode(int instr)
+{
+    static const Op DATA_OPS[] = {
+            Op::GENERIC,    // NOOP
+            Op::ADD,
+            Op::ADC,
+            Op::SUB,
+            Op::SBC,
+            Op::MUL,
+            Op::DIV,
+            Op::UDV,
+            Op::OR,
+            Op::AND,
+            Op::XOR,
+            Op::NOR,
+            Op::BIC,
+            Op::ROR,
+            Op::LSL,
+            Op::GENERIC,    // LSR
+            Op::GENERIC,    // ASR
+            Op::MOV,
+            Op::MVN,
+            Op::CMP,
+            Op::CMN,
+            Op::TST,
+            Op::TEQ,
+            Op::PUSH,
+            Op::POP
+    };
+    static const Op LOAD_OPS[] = {
+            Op::LDR,
+            Op::LDRB,
+            Op::LDRH,
+            Op::LDRSB,
+            Op::LDRSH,
+            Op::STR,
+            Op::STRB,
+            Op::STRH
+    };
+
+    DecodedInstruction d = generic(instr);
+    auto cond = (uint8_t) (((unsigned int) instr >> 28) & 0xF);
+    if (cond == COND_INVALID)
+    {
+        return d;
+    }
+
+    int rd = (instr >> 16) & 0xF;
+    int rn = (instr >> 12) & 0xF;
+
+    if (!(DATA_SIGNATURE & instr))
+    {
+        int opcode = (instr >> 20) & 0x1F;
+        if (opcode >= (int) (sizeof(DATA_OPS) / sizeof(DATA_OPS[0]))
+            || DATA_OPS[opcode] == Op::GENERIC)
+        {
+            return d;
+        }
+
+        d.op = DATA_OPS[opcode];
+        d.immediate = (instr & 0x02000000) != 0;
+        d.update = (instr & 0x04000000) != 0;
+        d.rd = (uint8_t) rd;
+        d.rn = (uint8_t) rn;
+
+        int operand = 0;
+        if (d.op == Op::MOV || d.op == Op::MVN)
+        {
+            operand = signExtend(instr & 0x0000FFFF, 16);
+        }
+        else if (d.op == Op::PUSH || d.op == Op::POP)
+        {
+            operand = signExtend(instr & 0x000FFFFF, 20);
+            if (d.op == Op::POP && d.immediate)
+            {
+                return generic(instr);
+            }
+        }
+        else
+        {
+            operand = signExtend(instr & 0x00000FFF, 12);
+        }
+
+        if (d.op >= Op::CMP && d.op <= Op::TEQ)
+        {
+            d.update = true;
+        }
+
+        if (d.immediate)
+        {
+            d.imm = operand;
+        }
+        else if (isRegisterIndex(operand))
+        {
+            d.rm = (uint8_t) operand;
+        }
+        else
+        {
+            return generic(instr);
+        }
+    }
+    else if (!(LOAD_SIGNATURE & instr))
+    {
+        bool hasImmediate = (instr & 0x02000000) != 0;
+        bool hasBase = (instr & 0x01000000) != 0;
+        int index = instr & 0x00000FFF;
+
+        if ((instr & 0x00800000) != 0)
+        {
+            return generic(instr);      // swp, ldrex, strex
+        }
+
+        d.op = LOAD_OPS[(instr >> 20) & 0x7];
+        d.immediate = hasImmediate;
+        d.rd = (uint8_t) rd;
+        d.rn = (uint8_t) rn;
+
+        if (hasImmediate)
+        {
+            d.address = hasBase ? Address::BASE_IMMEDIATE
+                                : Address::PC_IMMEDIATE;
+            d.imm = hasBase ? signExtend(instr & 0x00000FFF, 12)
+                            : signExtend(instr & 0x0000FFFF, 16);
+        }
+        else if (isRegisterIndex(index))
+        {
+            d.address = hasBase ? Address::BASE_REGISTER : Address::REGISTER;
+            d.rm = (uint8_t) index;
+        }
+        else
+        {
+            return generic(instr);
+        }
+    }
+    else if (!(BRANCH_SIGNATURE & instr))
+    {
+        d.op = (instr & 0x01000000) != 0 ? Op::BWL : Op::B;
+        d.immediate = (instr & 0x00800000) != 0;
+        d.imm = (int) ((unsigned int) signExtend(instr & 0x007FFFFF, 23) << 2);
+        d.rm = (uint8_t) (instr & 0x0000000F);
+    }
+    else if (!(COPROC_SIGNATURE & instr))
+    {
+        return d;
+    }
+    else // SWI
+    {
+        d.op = Op::SWI;
+        d.imm = instr & 0x00FFFFFF;
+    }
+
+    d.cond = cond;
+    d.handler = getHandler(d);
+    return d;
+}
+
+uint8_t m20::Decoder::getHandler(const DecodedInstruction &d)
+{
+    unsigned int form = 0;
+    if (d.op >= Op::ADD && d.op <= Op::TEQ)
+    {
+        form = (d.immediate ? 2 : 0) | (d.update ? 1 : 0);
+    }
+    else if (d.op >= Op::LDR && d.op <= Op::STRH)
+    {
+        form = static_cast<unsigned int>(d.address);
+    }
+    return (uint8_t) (static_cast<unsigned int>(d.op) * 4 + form);
+}
+
+m20::Fusion m20::Decoder::fuse(const DecodedInstruction *entries,
+                               size_t available, bool idle)
+{
+    const DecodedInstruction *e = entries;
+
+    if (idle && getLoopLength(e, available) != 0)
+    {
+        return Fusion::IDLE_LOOP;
+    }
+    if (available >= 4
+        && isCountdown(e[0])
+        && isIndexed(e[1], Op::LDRB, e[0].rd)
+        && e[1].rd != 15
+        && isIndexed(e[2], Op::STRB, e[0].rd)
+        && isImmediateBranch(e[3]))
+    {
+        return Fusion::COPY_LOOP;
+    }
+    if (available >= 3
+        && isCountdown(e[0])
+        && isIndexed(e[1], Op::STRB, e[0].rd)
+        && isImmediateBranch(e[2]))
+    {
+        return Fusion::FILL_LOOP;
+    }
+    if (available >= 3
+        && isRegisterPop(e[0], -1)
+        && isRegisterPop(e[1], 14)
+        && isReturn(e[2]))
+    {
+        return Fusion::POP_POP_RETURN;
+    }
+    if (available >= 2
+        && isRegisterPop(e[0], 14)
+        && isReturn(e[1]))
+    {
+        return Fusion::POP_RETURN;
+    }
+    if (available >= 2
+        && isCompare(e[0])
+        && isImmediateBranch(e[1]))
+    {
+        return Fusion::COMPARE_BRANCH;
+    }
+    if (available >= 2
+        && isRegisterPush(e[0])
+        && isRegisterPush(e[1]))
+    {
+        return Fusion::PUSH_PAIR;
+    }
+
+    return Fusion::NONE;
+}
+
+uint8_t m20::Decoder::getLength(Fusion fusion)
+{
+    switch (fusion)
+    {
+        case Fusion::COMPARE_BRANCH:
+        case Fusion::PUSH_PAIR:
+        case Fusion::POP_RETURN:
+            return 2;
+        case Fusion::POP_POP_RETURN:
+        case Fusion::FILL_LOOP:
+            return 3;
+        case Fusion::COPY_LOOP:
+            return 4;
+        default:
+            return 1;
+    }
+}
+
+uint8_t m20::Decoder::getLoopLength(const DecodedInstruction *entries,
+                                    size_t available)
+{
+    // Like the other sequences, even a branch to itself is left alone when
+    // fusion is disabled (one entry available)
+    if (available < 2)
+    {
+        return 0;
+    }
+    for (size_t k = 0; k < available; ++k)
+    {
+        const DecodedInstruction &e = entries[k];
+        if (isImmediateBranch(e))
+        {
+            return e.imm == -4 * (int) (k + 1) ? (uint8_t) (k + 1) : 0;
+        }
+        if (!isQuiet(e))
+        {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+std::string m20::Decoder::disassemble(int instr, unsigned int address)
+{
+    static const char *const DATA_NAMES[] = {
+            "noop", "add", "adc", "sub", "sbc", "mul", "div", "udv",
+            "or", "and", "xor", "nor", "bic", "ror", "lsl", "lsr",
+            "asr", "mov", "mvn", "cmp", "cmn", "tst", "teq", "push",
+            "pop", "srl", "srs"
+    };
+    static const char *const LOAD_NAMES[] = {
+            "ldr", "ldrb", "ldrh", "ldrsb", "ldrsh", "str", "strb", "strh",
+            "swp", "ldrex", "strex"
+    };
+
+    std::ostringstream ss;
+    auto cond = (int) (((unsigned int) instr >> 28) & 0xF);
+    bool immediate = (instr & 0x02000000) != 0;
+    int rd = (instr >> 16) & 0xF;
+    int rn = (instr >> 12) & 0xF;
+
+    if (cond == COND_INVALID)
+    {
+        ss << ".word " << hex((unsigned int) instr);
+    }
+    else if (!(DATA_SIGNATURE & instr))
+    {
+        int opcode = (instr >> 20) & 0x1F;
+        int imm12 = signExtend(instr & 0x00000FFF, 12);
+        int imm16 = signExtend(instr & 0x0000FFFF, 16);
+        int imm20 = signExtend(instr & 0x000FFFFF, 20);
+
+        // Every opcode but noop honours the update bit, which compares
+        // always imply
+        const char *update = (instr & 0x04000000) != 0 && opcode != 0x00
+                             && (opcode < 0x13 || opcode > 0x16)
+                             ? ".s" : "";
+
+        if (opcode == 0x1F)
+        {
+            ss << "halt" << CONDITION_NAMES[cond] << update;
+        }
+        else if (opcode > 0x1A)
+        {
+            ss << ".word " << hex((unsigned int) instr);
+        }
+        else
+        {
+            ss << DATA_NAMES[opcode] << CONDITION_NAMES[cond] << update;
+            auto operand = [&](int value) {
+                return immediate ? "#" + std::to_string(value)
+                                 : registerName(value & 0xF);
+            };
+
+            if (opcode == 0x00)
+            {
+                // noop takes no operands
+            }
+            else if (opcode <= 0x10)
+            {
+                ss << " " << registerName(rd) << ", " << registerName(rn)
+                   << ", " << operand(imm12);
+            }
+            else if (opcode <= 0x12)
+            {
+                ss << " " << registerName(rd) << ", " << operand(imm16);
+            }
+            else if (opcode <= 0x16)
+            {
+                ss << " " << registerName(rd) << ", " << operand(imm12);
+            }
+            else if (opcode <= 0x18)
+            {
+                ss << " " << operand(imm20);
+            }
+            else if (opcode == 0x19)
+            {
+                ss << " " << registerName(rd) << ", " << statusName(imm16);
+            }
+            else
+            {
+                ss << " " << statusName(rd) << ", " << registerName(imm16);
+            }
+        }
+    }
+    else if (!(LOAD_SIGNATURE & instr) && ((instr >> 20) & 0xF) > 0xA)
+    {
+        ss << ".word " << hex((unsigned int) instr);
+    }
+    else if (!(LOAD_SIGNATURE & instr))
+    {
+        bool hasBase = (instr & 0x01000000) != 0;
+        ss << LOAD_NAMES[(instr >> 20) & 0xF] << CONDITION_NAMES[cond]
+           << " " << registerName(rd) << ", ";
+        if (immediate && hasBase)
+        {
+            ss << registerName(rn) << ", #"
+               << signExtend(instr & 0x00000FFF, 12);
+        }
+        else if (immediate)
+        {
+            ss << hex(address + 4 + signExtend(instr & 0x0000FFFF, 16));
+        }
+        else if (hasBase)
+        {
+            ss << registerName(rn) << ", " << registerName(instr & 0xF);
+        }
+        else
+        {
+            ss << registerName(instr & 0xF);
+        }
+    }
+    else if (!(BRANCH_SIGNATURE & instr))
+    {
+        ss << ((instr & 0x01000000) != 0 ? "bwl" : "b")
+           << CONDITION_NAMES[cond] << " ";
+        if ((instr & 0x00800000) != 0)
+        {
+            ss << hex(address + 4 + ((unsigned int)
+                    signExtend(instr & 0x007FFFFF, 23) << 2));
+        }
+        else
+        {
+            ss << registerName(instr & 0xF);
+        }
+    }
+    else if (!(COPROC_SIGNATURE & instr))
+    {
+        ss << ".word " << hex((unsigned int) instr);
+    }
+    else
+    {
+        ss << "swi" << CONDITION_NAMES[cond] << " "
+           << hex((unsigned int) instr & 0x00FFFFFF);
+    }
+
+    return ss.str();
+}
+
+bool m20::Decoder::endsBlock(const DecodedInstruction &d)
+{
+    switch (d.op)
+    {
+        case Op::GENERIC:
+        case Op::B:
+        case Op::BWL:
+        case Op::SWI:
+            return true;
+        case Op::POP:
+            return d.rm == 15;
+        default:
+            return ((d.op >= Op::ADD && d.op <= Op::MVN)
+                    || (d.op >= Op::LDR && d.op <= Op::LDRSH))
+                   && d.rd == 15;
+    }
+}
+
+bool m20::Decoder::isCompare(const DecodedInstruction &d)
+{
+    return d.op >= Op::CMP && d.op <= Op::TEQ && d.cond == COND_AL;
+}
+
+bool m20::Decoder::isImmediateBranch(const DecodedInstruction &d)
+{
+    return d.op == Op::B && d.immediate;
+}
+
+bool m20::Decoder::isRegisterPush(const DecodedInstruction &d)
+{
+    return d.op == Op::PUSH && !d.immediate && !d.update
+           && d.cond == COND_AL;
+}
+
+bool m20::Decoder::isRegisterPop(const DecodedInstruction &d, int reg)
+{
+    return d.op == Op::POP && !d.update && d.cond == COND_AL && d.rm != 15
+           && (reg < 0 || d.rm == reg);
+}
+
+bool m20::Decoder::isReturn(const DecodedInstruction &d)
+{
+    return d.op == Op::MOV && !d.immediate && !d.update
+           && d.rd == 15 && d.rm == 14 && d.cond == COND_AL;
+}
+
+bool m20::Decoder::isQuiet(const DecodedInstruction &d)
+{
+    return ((d.op >= Op::ADD && d.op <= Op::TEQ)
+            || (d.op >= Op::LDR && d.op <= Op::LDRSH))
+           && d.rd != 15;
+}
+
+bool m20::Decoder::isCountdown(const DecodedInstruction &d)
+{
+    return d.op == Op::SUB && d.immediate && d.update
+           && d.rd == d.rn && d.rd != 15 && d.cond == COND_AL;
+}
+
+bool m20::Decoder::isIndexed(const DecodedInstruction &d, Op op, int index)
+{
+    return d.op == op && d.address == Address::BASE_REGISTER
+           && d.rm == index && d.cond == COND_AL;
+}
@@ -0,0 +1,223 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Instruction predecoder and superinstruction fusion for the M20
+ *      simulator.
+ * =============================================================================
+ */
+
+#ifndef M20_ASSEMBLY_DECODER_H
+#define M20_ASSEMBLY_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace m20
+{
+    /**
+     * Operation of a predecoded instruction. Anything the predecoder does not
+     *  handle (aborting opcodes, status register access, malformed register
+     *  fields, ...) is decoded as GENERIC and executed by the reference
+     *  handlers from the raw instruction word.
+     */
+    enum class Op : uint8_t
+    {
+        GENERIC,
+
+        // Data processing
+        ADD,
+        ADC,
+        SUB,
+        SBC,
+        MUL,
+        DIV,
+        UDV,
+        OR,
+        AND,
+        XOR,
+        NOR,
+        BIC,
+        ROR,
+        LSL,
+        MOV,
+        MVN,
+        CMP,
+        CMN,
+        TST,
+        TEQ,
+        PUSH,
+        POP,
+
+        // Data loading
+        LDR,
+        LDRB,
+        LDRH,
+        LDRSB,
+        LDRSH,
+        STR,
+        STRB,
+        STRH,
+
+        // Branching
+        B,
+        BWL,
+
+        // Interrupt
+        SWI
+    };
+
+    /**
+     * Superinstructions recognized by the fusion pass. The head entry of a
+     *  fused sequence carries the fusion kind, the following entries keep
+     *  their own (unfused) decodings.
+     */
+    enum class Fusion : uint8_t
+    {
+        NONE,
+        COMPARE_BRANCH,     // cmp/cmn/tst/teq, b<cond>
+        PUSH_PAIR,          // push rX, push rY
+        POP_RETURN,         // pop lp, mov pc, lp
+        POP_POP_RETURN,     // pop rX, pop lp, mov pc, lp
+        COPY_LOOP,          // sub.s rI, rI, #n, ldrb, strb, b<cond>
+        FILL_LOOP,          // sub.s rI, rI, #n, strb, b<cond>
+        IDLE_LOOP,          // Loads and ALU ops, b<cond> back to the first
+        BREAKPOINT          // Not a sequence: stops run() before the word
+    };
+
+    const unsigned int FUSION_COUNT = 9;
+
+    const std::string FUSION_NAMES[] = {
+            "none",
+            "cmp+b",
+            "push+push",
+            "pop+ret",
+            "pop+pop+ret",
+            "sub.s+ldrb+strb+b",
+            "sub.s+strb+b",
+            "idle loop",
+            "breakpoint"
+    };
+
+    /**
+     * Addressing of a predecoded load/store
+     */
+    enum class Address : uint8_t
+    {
+        BASE_IMMEDIATE,     // rn + imm
+        BASE_REGISTER,      // rn + rm
+        PC_IMMEDIATE,       // pc + imm
+        REGISTER            // rm
+    };
+
+    /**
+     * Number of specialized handlers: four operand forms per op
+     */
+    const unsigned int HANDLER_COUNT = (static_cast<unsigned int>(Op::SWI) + 1)
+                                       * 4;
+
+    /**
+     * A single instruction word decoded into its fields. A length of zero
+     *  marks an entry that has not been decoded (or has been invalidated).
+     */
+    struct DecodedInstruction
+    {
+        Op op;
+        Fusion fusion;
+        Address address;
+        uint8_t cond;
+        uint8_t rd;
+        uint8_t rn;
+        uint8_t rm;
+        bool immediate;
+        bool update;
+        uint8_t length;
+        uint8_t handler;    // See Decoder::getHandler
+        int imm;
+        int raw;
+    };
+
+    /**
+     * Decodes instruction words and fuses common instruction sequences
+     */
+    class Decoder
+    {
+    public:
+        /**
+         * Longest sequence of instructions covered by one fused entry
+         */
+        static const unsigned int MAX_FUSION = 4;
+
+        /**
+         * Decodes a single instruction word
+         * @param instr Raw instruction word
+         * @return Decoded instruction (with length 1 and no fusion)
+         */
+        static DecodedInstruction decode(int instr);
+
+        /**
+         * Selects the handler specialized for an entry's op and operand form
+         * @param d Decoded instruction
+         * @return Op * 4 + form, where the form is (immediate, update) for
+         *  data processing, the address mode for loads and stores, and 0
+         *  otherwise
+         */
+        static uint8_t getHandler(const DecodedInstruction &d);
+
+        /**
+         * Attempts to fuse the sequence starting at entries[0]
+         * @param entries Decoded entries, consecutive in memory
+         * @param available Number of entries that may be inspected
+         * @param idle Whether a loop may be fused as an IDLE_LOOP
+         * @return Fusion kind (NONE if no sequence matched)
+         */
+        static Fusion fuse(const DecodedInstruction *entries,
+                           size_t available, bool idle = true);
+
+        /**
+         * Returns the number of instructions covered by a fusion kind (1 for
+         *  IDLE_LOOP, whose length depends on the loop)
+         */
+        static uint8_t getLength(Fusion fusion);
+
+        /**
+         * Measures a candidate idle loop: instructions that only write
+         *  registers other than pc (ALU ops and loads), then a branch back
+         *  to entries[0]. Whether an iteration really changes nothing is
+         *  only known when it runs.
+         * @return Instructions in the loop, or 0 if it is not a candidate
+         */
+        static uint8_t getLoopLength(const DecodedInstruction *entries,
+                                     size_t available);
+
+        /**
+         * Formats an instruction word in assembler syntax
+         * @param instr Raw instruction word
+         * @param address Address of the instruction (for branch targets)
+         * @return Assembly text, or a .word directive if undefined
+         */
+        static std::string disassemble(int instr, unsigned int address);
+
+        /**
+         * Whether execution may continue anywhere but the next word after d
+         *  (branches, SWIs, writes to PC and anything left to the reference
+         *  decoder)
+         */
+        static bool endsBlock(const DecodedInstruction &d);
+
+    private:
+        static bool isCompare(const DecodedInstruction &d);
+        static bool isImmediateBranch(const DecodedInstruction &d);
+        static bool isRegisterPush(const DecodedInstruction &d);
+        static bool isRegisterPop(const DecodedInstruction &d, int reg);
+        static bool isReturn(const DecodedInstruction &d);
+        static bool isCountdown(const DecodedInstruction &d);
+        static bool isIndexed(const DecodedInstruction &d, Op op, int index);
+        static bool isQuiet(const DecodedInstruction &d);
+    };
+}
+
+#endif // M20_ASSEMBLY_DECODER_H
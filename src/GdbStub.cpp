@@ -0,0 +1,726 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      GDB remote serial protocol stub for the simulator.
+ *      (Implementation)
+ * =============================================================================
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "GdbStub.h"
+
+namespace
+{
+    const unsigned int REGISTER_COUNT = 17;     // r0-r12, sp, lp, pc, st
+    const size_t MAX_MEMORY = 2048;             // Bytes per m/M packet
+
+    // Signal numbers as gdb defines them
+    const int SIGNAL_INT = 2;
+    const int SIGNAL_ILL = 4;
+    const int SIGNAL_TRAP = 5;
+    const int SIGNAL_ABRT = 6;
+    const int SIGNAL_SEGV = 11;
+
+    const char *const TARGET_XML =
+            "<?xml version=\"1.0\"?>"
+            "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+            "<target version=\"1.0\">"
+            "<feature name=\"org.m20.core\">"
+            "<reg name=\"r0\" bitsize=\"32\" regnum=\"0\"/>"
+            "<reg name=\"r1\" bitsize=\"32\"/>"
+            "<reg name=\"r2\" bitsize=\"32\"/>"
+            "<reg name=\"r3\" bitsize=\"32\"/>"
+            "<reg name=\"r4\" bitsize=\"32\"/>"
+            "<reg name=\"r5\" bitsize=\"32\"/>"
+            "<reg name=\"r6\" bitsize=\"32\"/>"
+            "<reg name=\"r7\" bitsize=\"32\"/>"
+            "<reg name=\"r8\" bitsize=\"32\"/>"
+            "<reg name=\"r9\" bitsize=\"32\"/>"
+            "<reg name=\"r10\" bitsize=\"32\"/>"
+            "<reg name=\"r11\" bitsize=\"32\"/>"
+            "<reg name=\"r12\" bitsize=\"32\"/>"
+            "<reg name=\"sp\" bitsize=\"32\" type=\"data_ptr\"/>"
+            "<reg name=\"lp\" bitsize=\"32\" type=\"code_ptr\"/>"
+            "<reg name=\"pc\" bitsize=\"32\" type=\"code_ptr\"/>"
+            "<reg name=\"st\" bitsize=\"32\"/>"
+            "</feature>"
+            "</target>";
+
+    std::string toHex(unsigned int value, int digits)
+    {
+        char buffer[9];
+        std::snprintf(buffer, sizeof(buffer), "%0*x", digits, value);
+        return buffer;
+    }
+
+    /**
+     * Parses hex digits at pos up to a delimiter, advancing pos past it
+     * @return False if there are no digits or a different delimiter
+     */
+    bool parseHex(const std::string &s, size_t &pos, char delimiter,
+                  unsigned long &value)
+    {
+        const char *begin = s.c_str() + pos;
+        char *end = nullptr;
+        value = std::strtoul(begin, &end, 16);
+        if (end == begin || *end != delimiter)
+        {
+            return false;
+        }
+        pos += (size_t) (end - begin) + (delimiter != '\0' ? 1 : 0);
+        return true;
+    }
+
+    int fromHexDigit(char c)
+    {
+        if (c >= '0' && c <= '9')
+        {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f')
+        {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F')
+        {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    /**
+     * Decodes pairs of hex digits into bytes
+     * @return False if the string is not hex
+     */
+    bool decodeHex(const char *hex, size_t bytes, std::vector<char> &out)
+    {
+        out.resize(bytes);
+        for (size_t i = 0; i < bytes; ++i)
+        {
+            int high = fromHexDigit(hex[2 * i]);
+            int low = high < 0 ? -1 : fromHexDigit(hex[2 * i + 1]);
+            if (low < 0)
+            {
+                return false;
+            }
+            out[i] = (char) (high << 4 | low);
+        }
+        return true;
+    }
+}
+
+m20::GdbStub::GdbStub(Simulator &simulator, std::ostream &log)
+        : simulator(simulator),
+          history(simulator),
+          log(log),
+          server(-1),
+          client(-1),
+          acks(true),
+          last(Status::RUNNING)
+{
+    //
+}
+
+m20::GdbStub::~GdbStub()
+{
+    close();
+    if (server >= 0)
+    {
+        ::close(server);
+    }
+    if (!path.empty())
+    {
+        unlink(path.c_str());
+    }
+}
+
+bool m20::GdbStub::listen(const std::string &endpoint)
+{
+    bool tcp = !endpoint.empty()
+               && endpoint.find_first_not_of("0123456789") == std::string::npos;
+    if (tcp)
+    {
+        unsigned long port = std::strtoul(endpoint.c_str(), nullptr, 10);
+        if (port == 0 || port > 65535)
+        {
+            log << "Invalid port " << endpoint << std::endl;
+            return false;
+        }
+
+        server = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons((uint16_t) port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (server < 0
+            || setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse,
+                          sizeof(reuse)) != 0
+            || bind(server, reinterpret_cast<sockaddr *>(&address),
+                    sizeof(address)) != 0
+            || ::listen(server, 1) != 0)
+        {
+            log << "Cannot listen on port " << port << ": "
+                << std::strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    else
+    {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (endpoint.empty() || endpoint.size() >= sizeof(address.sun_path))
+        {
+            log << "Invalid socket path " << endpoint << std::endl;
+            return false;
+        }
+        std::strcpy(address.sun_path, endpoint.c_str());
+
+        // Replace a socket left behind by an earlier run, but nothing else
+        struct stat info = {};
+        if (stat(endpoint.c_str(), &info) == 0 && S_ISSOCK(info.st_mode))
+        {
+            unlink(endpoint.c_str());
+        }
+
+        server = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (server < 0
+            || bind(server, reinterpret_cast<sockaddr *>(&address),
+                    sizeof(address)) != 0)
+        {
+            log << "Cannot bind " << endpoint << ": " << std::strerror(errno)
+                << std::endl;
+            return false;
+        }
+        path = endpoint;
+        if (::listen(server, 1) != 0)
+        {
+            log << "Cannot listen on " << endpoint << ": "
+                << std::strerror(errno) << std::endl;
+            return false;
+        }
+    }
+
+    log << "Waiting for gdb on " << (tcp ? "localhost:" : "") << endpoint
+        << std::endl;
+    return true;
+}
+
+bool m20::GdbStub::serve()
+{
+    client = accept(server, nullptr, nullptr);
+    if (client < 0)
+    {
+        log << "Cannot accept a connection: " << std::strerror(errno)
+            << std::endl;
+        return false;
+    }
+
+    history.reset();
+    acks = true;
+    last = Status::RUNNING;
+
+    bool done = false;
+    std::string packet;
+    while (!done && receive(packet))
+    {
+        std::string reply = handle(packet, done);
+        if (packet != "k" && !send(reply))
+        {
+            break;
+        }
+        if (packet == "QStartNoAckMode")
+        {
+            acks = false;
+        }
+    }
+    close();
+    return true;
+}
+
+bool m20::GdbStub::receive(std::string &packet)
+{
+    char c = 0;
+    for (;;)
+    {
+        // Skip acknowledgements and interrupts outside of a run
+        do
+        {
+            if (!readByte(c))
+            {
+                return false;
+            }
+        } while (c != '$');
+
+        packet.clear();
+        unsigned int sum = 0;
+        while (readByte(c) && c != '#')
+        {
+            packet += c;
+            sum += (unsigned char) c;
+        }
+        char check[2];
+        if (c != '#' || !readByte(check[0]) || !readByte(check[1]))
+        {
+            return false;
+        }
+
+        int high = fromHexDigit(check[0]);
+        int low = fromHexDigit(check[1]);
+        bool valid = high >= 0 && low >= 0
+                     && (unsigned int) (high << 4 | low) == (sum & 0xff);
+        if (acks && ::send(client, valid ? "+" : "-", 1, MSG_NOSIGNAL) != 1)
+        {
+            return false;
+        }
+        if (valid || !acks)
+        {
+            return true;
+        }
+    }
+}
+
+bool m20::GdbStub::send(const std::string &packet)
+{
+    unsigned int sum = 0;
+    for (char c : packet)
+    {
+        sum += (unsigned char) c;
+    }
+    std::string frame = "$" + packet + "#" + toHex(sum & 0xff, 2);
+
+    for (;;)
+    {
+        if (::send(client, frame.data(), frame.size(), MSG_NOSIGNAL)
+            != (ssize_t) frame.size())
+        {
+            return false;
+        }
+        if (!acks)
+        {
+            return true;
+        }
+
+        char c = 0;
+        do
+        {
+            if (!readByte(c))
+            {
+                return false;
+            }
+        } while (c != '+' && c != '-');
+        if (c == '+')
+        {
+            return true;
+        }
+    }
+}
+
+bool m20::GdbStub::readByte(char &c)
+{
+    ssize_t count;
+    do
+    {
+        count = recv(client, &c, 1, 0);
+    } while (count < 0 && errno == EINTR);
+    return count == 1;
+}
+
+bool m20::GdbStub::interrupted()
+{
+    pollfd events = {client, POLLIN, 0};
+    char c = 0;
+    while (poll(&events, 1, 0) == 1 && (events.revents & POLLIN) != 0)
+    {
+        if (!readByte(c))
+        {
+            return true;    // Disconnected; the next receive notices
+        }
+        if (c == 0x03)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string m20::GdbStub::handle(const std::string &packet, bool &done)
+{
+    if (packet.empty())
+    {
+        return "";
+    }
+
+    unsigned long reg = 0;
+    unsigned long value = 0;
+    size_t pos = 1;
+    switch (packet[0])
+    {
+        case '?':
+            return last == Status::RUNNING ? "S05" : stopReply(last);
+        case 'g':
+            return readRegisters();
+        case 'G':
+            if (packet.size() != 1 + REGISTER_COUNT * 8)
+            {
+                return "E01";
+            }
+            for (unsigned int i = 0; i < REGISTER_COUNT; ++i)
+            {
+                std::string word = packet.substr(1 + i * 8, 8);
+                pos = 0;
+                if (!parseHex(word, pos, '\0', value))
+                {
+                    return "E01";
+                }
+                writeRegister(i, (unsigned int) value);
+            }
+            return "OK";
+        case 'p':
+            if (!parseHex(packet, pos, '\0', reg) || reg >= REGISTER_COUNT)
+            {
+                return "E01";
+            }
+            return readRegisters().substr(reg * 8, 8);
+        case 'P':
+            if (!parseHex(packet, pos, '=', reg)
+                || !parseHex(packet, pos, '\0', value)
+                || !writeRegister((unsigned int) reg, (unsigned int) value))
+            {
+                return "E01";
+            }
+            return "OK";
+        case 'm':
+            return readMemory(packet.substr(1));
+        case 'M':
+            return writeMemory(packet.substr(1));
+        case 'c':
+            return resume(packet, false);
+        case 's':
+            return resume(packet, true);
+        case 'b':
+            return packet == "bs" ? reverseStep() : "";
+        case 'Z':
+            return setPoint(packet.substr(1), true);
+        case 'z':
+            return setPoint(packet.substr(1), false);
+        case 'q':
+        case 'Q':
+            return query(packet);
+        case 'H':
+        case 'T':
+            return "OK";
+        case 'D':
+            done = true;
+            return "OK";
+        case 'k':
+            done = true;
+            return "";
+        default:
+            return "";
+    }
+}
+
+std::string m20::GdbStub::query(const std::string &packet)
+{
+    if (packet.compare(0, 10, "qSupported") == 0)
+    {
+        return "PacketSize=4000;QStartNoAckMode+;ReverseStep+;"
+               "qXfer:features:read+";
+    }
+    if (packet == "QStartNoAckMode")
+    {
+        return "OK";        // Acknowledged still; serve() turns acks off
+    }
+    if (packet.compare(0, 31, "qXfer:features:read:target.xml:") == 0)
+    {
+        unsigned long offset = 0;
+        unsigned long length = 0;
+        size_t pos = 31;
+        if (!parseHex(packet, pos, ',', offset)
+            || !parseHex(packet, pos, '\0', length))
+        {
+            return "E01";
+        }
+        std::string xml(TARGET_XML);
+        if (offset >= xml.size())
+        {
+            return "l";
+        }
+        std::string part = xml.substr(offset, length);
+        return (offset + part.size() < xml.size() ? "m" : "l") + part;
+    }
+    if (packet == "qAttached")
+    {
+        return "1";
+    }
+    if (packet == "qC")
+    {
+        return "QC1";
+    }
+    if (packet == "qfThreadInfo")
+    {
+        return "m1";
+    }
+    if (packet == "qsThreadInfo")
+    {
+        return "l";
+    }
+    if (packet == "qOffsets")
+    {
+        return "Text=0;Data=0;Bss=0";
+    }
+    return "";
+}
+
+std::string m20::GdbStub::resume(const std::string &packet, bool step)
+{
+    size_t pos = 1;
+    unsigned long address = 0;
+    if (packet.size() > 1)
+    {
+        if (!parseHex(packet, pos, '\0', address))
+        {
+            return "E01";
+        }
+        simulator.getRegisters().pc = (int) address;
+    }
+
+    Status status;
+    if (step)
+    {
+        // The other engines may run a whole fused sequence
+        Engine engine = simulator.getEngine();
+        simulator.setEngine(Engine::REFERENCE);
+        status = history.run(1);
+        simulator.setEngine(engine);
+        if (status == Status::RUNNING)
+        {
+            status = Status::BREAKPOINT;
+        }
+    }
+    else
+    {
+        while ((status = history.run(CHUNK)) == Status::RUNNING
+               && !interrupted())
+        {
+            //
+        }
+    }
+
+    last = status;
+    return stopReply(status);
+}
+
+std::string m20::GdbStub::reverseStep()
+{
+    if (!history.reverseStep())
+    {
+        return "T" + toHex(SIGNAL_TRAP, 2) + "replaylog:begin;";
+    }
+    last = Status::BREAKPOINT;
+    return stopReply(last);
+}
+
+std::string m20::GdbStub::stopReply(Status status)
+{
+    switch (status)
+    {
+        case Status::RUNNING:
+            return "S" + toHex(SIGNAL_INT, 2);
+        case Status::HALTED:
+            return "W" + toHex((unsigned int) *simulator.getRegister(0) & 0xff,
+                               2);
+        case Status::UNDEFINED_INSTRUCTION:
+            return "S" + toHex(SIGNAL_ILL, 2);
+        case Status::PREFETCH_ABORT:
+        case Status::DATA_ABORT:
+            return "S" + toHex(SIGNAL_SEGV, 2);
+        case Status::WATCHPOINT:
+        {
+            const WatchHit &hit = simulator.getWatchHit();
+            const char *kind = hit.access == Access::READ ? "rwatch" : "watch";
+            for (const auto &watch : watches)
+            {
+                if (watch.access == Access::READ_WRITE
+                    && hit.address < watch.address + watch.size
+                    && watch.address < hit.address + hit.size)
+                {
+                    kind = "awatch";
+                }
+            }
+            return "T" + toHex(SIGNAL_TRAP, 2) + kind + ":"
+                   + toHex(hit.address, 8) + ";";
+        }
+        case Status::BREAKPOINT:
+            return "S" + toHex(SIGNAL_TRAP, 2);
+        default:
+            return "S" + toHex(SIGNAL_ABRT, 2);
+    }
+}
+
+std::string m20::GdbStub::readRegisters()
+{
+    std::string hex;
+    for (int i = 0; i < 16; ++i)
+    {
+        hex += toHex((unsigned int) *simulator.getRegister(i), 8);
+    }
+    hex += toHex((unsigned int) simulator.getRegisters().st, 8);
+    return hex;
+}
+
+bool m20::GdbStub::writeRegister(unsigned int reg, unsigned int value)
+{
+    if (reg < 16)
+    {
+        *simulator.getRegister((int) reg) = (int) value;
+        return true;
+    }
+    if (reg == 16)
+    {
+        simulator.getRegisters().st = (int) value;
+        return true;
+    }
+    return false;
+}
+
+std::string m20::GdbStub::readMemory(const std::string &args)
+{
+    unsigned long address = 0;
+    unsigned long length = 0;
+    size_t pos = 0;
+    if (!parseHex(args, pos, ',', address)
+        || !parseHex(args, pos, '\0', length))
+    {
+        return "E01";
+    }
+
+    std::vector<char> bytes(std::min((size_t) length, MAX_MEMORY));
+    if (address > 0xffffffff
+        || !simulator.readMemory((unsigned int) address, bytes.data(),
+                                 bytes.size()))
+    {
+        return "E01";
+    }
+    std::string hex;
+    for (char c : bytes)
+    {
+        hex += toHex((unsigned char) c, 2);
+    }
+    return hex;
+}
+
+std::string m20::GdbStub::writeMemory(const std::string &args)
+{
+    unsigned long address = 0;
+    unsigned long length = 0;
+    size_t pos = 0;
+    std::vector<char> bytes;
+    if (!parseHex(args, pos, ',', address)
+        || !parseHex(args, pos, ':', length)
+        || args.size() - pos != length * 2
+        || !decodeHex(args.c_str() + pos, length, bytes))
+    {
+        return "E01";
+    }
+    if (address > 0xffffffff
+        || !simulator.writeMemory((unsigned int) address, bytes.data(),
+                                  bytes.size()))
+    {
+        return "E01";
+    }
+    return "OK";
+}
+
+std::string m20::GdbStub::setPoint(const std::string &args, bool insert)
+{
+    // <type>,<addr>,<kind>
+    unsigned long type = 0;
+    unsigned long address = 0;
+    unsigned long kind = 0;
+    size_t pos = 0;
+    if (!parseHex(args, pos, ',', type) || !parseHex(args, pos, ',', address)
+        || !parseHex(args, pos, '\0', kind) || address > 0xffffffff)
+    {
+        return "E01";
+    }
+
+    if (type == 0 || type == 1)
+    {
+        // Software and hardware breakpoints are the same thing here
+        if (insert)
+        {
+            return simulator.addBreakpoint((unsigned int) address) ? "OK"
+                                                                   : "E01";
+        }
+        simulator.removeBreakpoint((unsigned int) address);
+        return "OK";
+    }
+    if (type > 4 || kind == 0)
+    {
+        return "";
+    }
+
+    static const Access ACCESSES[] = {Access::WRITE, Access::READ,
+                                      Access::READ_WRITE};
+    Watch watch = {(unsigned int) address, kind, ACCESSES[type - 2]};
+    auto match = [&watch](const Watch &w)
+    {
+        return w.address == watch.address && w.size == watch.size
+               && w.access == watch.access;
+    };
+    if (insert)
+    {
+        watches.push_back(watch);
+        if (!simulator.addWatchpoint(watch.address, watch.size, watch.access))
+        {
+            watches.pop_back();
+            return "E01";
+        }
+        return "OK";
+    }
+
+    // Watchpoints can only be cleared all at once
+    auto i = std::find_if(watches.begin(), watches.end(), match);
+    if (i != watches.end())
+    {
+        watches.erase(i);
+        armWatchpoints();
+    }
+    return "OK";
+}
+
+void m20::GdbStub::armWatchpoints()
+{
+    simulator.clearWatchpoints();
+    for (const auto &watch : watches)
+    {
+        simulator.addWatchpoint(watch.address, watch.size, watch.access);
+    }
+}
+
+void m20::GdbStub::close()
+{
+    if (client >= 0)
+    {
+        ::close(client);
+        client = -1;
+    }
+}
@@ -0,0 +1,97 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      GDB remote serial protocol stub for the simulator.
+ * =============================================================================
+ */
+
+#ifndef M20_ASSEMBLY_GDBSTUB_H
+#define M20_ASSEMBLY_GDBSTUB_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "History.h"
+#include "Simulator.h"
+
+namespace m20
+{
+    /**
+     * Serves one debugger connection over TCP or a unix socket. The target
+     *  has 17 registers as gdb sees them: r0-r12, sp and lp of the current
+     *  mode, pc and st, all 32-bit and big endian like memory.
+     *
+     * Breakpoints go to Simulator::addBreakpoint, so continuing runs on the
+     *  selected engine at full speed until one is reached. Steps run one
+     *  instruction on the reference engine. Execution goes through a
+     *  History, so the debugger can also step backwards (bs).
+     */
+    class GdbStub
+    {
+    public:
+        static const size_t CHUNK = 100000;     // Instructions between polls
+
+        explicit GdbStub(Simulator &simulator, std::ostream &log = std::cerr);
+
+        ~GdbStub();
+
+        GdbStub(const GdbStub &) = delete;
+        GdbStub &operator=(const GdbStub &) = delete;
+
+        /**
+         * Opens the listening socket
+         * @param endpoint TCP port on 127.0.0.1 if numeric, else the path of
+         *  a unix socket
+         * @return False (after logging why) if the socket cannot be opened
+         */
+        bool listen(const std::string &endpoint);
+
+        /**
+         * Resets the simulator, waits for a debugger and serves it until it
+         *  kills or detaches from the target or disconnects
+         * @return False if no connection could be accepted
+         */
+        bool serve();
+
+    private:
+        struct Watch
+        {
+            unsigned int address;
+            size_t size;
+            Access access;
+        };
+
+        Simulator &simulator;
+        History history;
+        std::ostream &log;
+        int server;
+        int client;
+        std::string path;           // Unix socket to remove, if any
+        bool acks;
+        Status last;                // Reason of the last stop
+        std::vector<Watch> watches;
+
+        bool receive(std::string &packet);
+        bool send(const std::string &packet);
+        bool readByte(char &c);
+        bool interrupted();
+        std::string handle(const std::string &packet, bool &done);
+        std::string query(const std::string &packet);
+        std::string resume(const std::string &packet, bool step);
+        std::string reverseStep();
+        std::string stopReply(Status status);
+        std::string readRegisters();
+        bool writeRegister(unsigned int reg, unsigned int value);
+        std::string readMemory(const std::string &args);
+        std::string writeMemory(const std::string &args);
+        std::string setPoint(const std::string &args, bool insert);
+        void armWatchpoints();
+        void close();
+    };
+}
+
+#endif // M20_ASSEMBLY_GDBSTUB_H
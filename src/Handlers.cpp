@@ -0,0 +1,159 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Handlers for predecoded instructions, specialized at compile time for
+ *      each op and operand form. They live apart from Simulator.cpp so that
+ *      their instantiations do not crowd the reference engine's inlining.
+ *      (Implementation)
+ * =============================================================================
+ */
+
+#include "Simulator.h"
+
+template <unsigned int HANDLER>
+void m20::Simulator::executeHandler(Simulator &sim, const DecodedInstruction &d)
+{
+    constexpr auto OP = static_cast<Op>(HANDLER / 4);
+    if (OP >= Op::ADD && OP <= Op::TEQ)
+    {
+        sim.executeData<OP, (HANDLER & 2) != 0, (HANDLER & 1) != 0>(d);
+    }
+    else if (OP >= Op::LDR && OP <= Op::STRH)
+    {
+        sim.executeMemory<OP, static_cast<Address>(HANDLER & 3)>(d);
+    }
+    else
+    {
+        sim.executeGeneric(d);
+    }
+}
+
+template <m20::Op OP, bool IMMEDIATE, bool UPDATE>
+void m20::Simulator::executeData(const DecodedInstruction &d)
+{
+    // Moves take no first operand and compares read rd instead of rn
+    const bool move = OP == Op::MOV || OP == Op::MVN;
+    const bool compare = OP >= Op::CMP && OP <= Op::TEQ;
+
+    int operand = IMMEDIATE ? d.imm : *getRegister(d.rm);
+    int aluA = move ? operand : *getRegister(compare ? d.rd : d.rn);
+    int aluB = move ? 0 : operand;
+    if ((OP == Op::DIV || OP == Op::UDV) && !isDivisor(aluB, OP == Op::UDV))
+    {
+        return;
+    }
+    long long aluReg = compute<OP>(aluA, aluB);
+    if (!compare)
+    {
+        *getRegister(d.rd) = (int) aluReg;
+    }
+
+    if (UPDATE)
+    {
+        updateStatus(aluReg, aluA, aluB);
+    }
+}
+
+template <m20::Op OP>
+long long m20::Simulator::compute(int a, int b)
+{
+    switch (OP)
+    {
+        case Op::ADD:
+        case Op::CMN:
+            return a + b;
+        case Op::ADC:
+            return a + b + ((regs.st & ST_C) != 0 ? 1 : 0);
+        case Op::SUB:
+        case Op::CMP:
+            return a - b;
+        case Op::SBC:
+            return a - b - ((regs.st & ST_C) == 0 ? 1 : 0);
+        case Op::MUL:
+            return a * b;
+        case Op::DIV:
+            return divide(a, b);
+        case Op::UDV:
+            return divideUnsigned(a, b);
+        case Op::OR:
+            return a | b;
+        case Op::AND:
+        case Op::TST:
+            return a & b;
+        case Op::XOR:
+        case Op::TEQ:
+            return a ^ b;
+        case Op::NOR:
+            return ~(a | b);
+        case Op::BIC:
+            return a & ~b;
+        case Op::ROR:
+            return (a >> (b % 32)) | (a << (32 - (b % 32)));
+        case Op::LSL:
+            return a << b;
+        case Op::MOV:
+            return a;
+        case Op::MVN:
+            return ~a;
+        default:
+            return 0;
+    }
+}
+
+template <m20::Op OP, m20::Address ADDRESS>
+void m20::Simulator::executeMemory(const DecodedInstruction &d)
+{
+    const unsigned int size = OP == Op::LDR || OP == Op::STR ? 4
+                            : OP == Op::LDRH || OP == Op::LDRSH
+                              || OP == Op::STRH ? 2 : 1;
+
+    int addr = getAddress<ADDRESS>(d);
+    if (!isMapped(addr, size))
+    {
+        return;
+    }
+
+    switch (OP)
+    {
+        case Op::LDR:
+            *getRegister(d.rd) = loadWord(addr);
+            break;
+        case Op::LDRB:
+            *getRegister(d.rd) = (int) ((unsigned int) loadByte(addr));
+            break;
+        case Op::LDRH:
+            *getRegister(d.rd) = (int) ((unsigned int) loadHalfword(addr));
+            break;
+        case Op::LDRSB:
+            *getRegister(d.rd) = loadByte(addr);
+            break;
+        case Op::LDRSH:
+            *getRegister(d.rd) = loadHalfword(addr);
+            break;
+        case Op::STR:
+            storeWord(addr, *getRegister(d.rd));
+            break;
+        case Op::STRB:
+            storeByte(addr, *getRegister(d.rd));
+            break;
+        case Op::STRH:
+            storeHalfword(addr, *getRegister(d.rd));
+            break;
+        default:
+            break;
+    }
+}
+
+template <size_t... HANDLER>
+constexpr std::array<m20::Simulator::Handler, sizeof...(HANDLER)>
+m20::Simulator::getHandlers(std::index_sequence<HANDLER...>)
+{
+    return {{&executeHandler<HANDLER>...}};
+}
+
+const std::array<m20::Simulator::Handler, m20::HANDLER_COUNT>
+        m20::Simulator::HANDLERS = getHandlers(
+                std::make_index_sequence<HANDLER_COUNT>());
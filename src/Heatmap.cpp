@@ -0,0 +1,234 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Guest memory access heatmap and working set of a simulator run.
+ *      (Implementation)
+ * =============================================================================
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+#include "Heatmap.h"
+
+namespace
+{
+    const char *const REGION_NAMES[] = {"text", "data", "stack"};
+    const char *const MODE_NAMES[] = {"usr", "svr", "int", "abt"};
+
+    // Page map shades, from untouched to the hottest page (log scale)
+    const char SHADES[] = " .:-=+*#%@";
+    const unsigned int SHADE_COUNT = sizeof(SHADES) - 1;
+    const unsigned int MAP_WIDTH = 64;
+
+    const size_t MAX_LINES = 10;
+    const size_t MAX_WINDOWS = 24;
+}
+
+m20::Heatmap::Heatmap(size_t memorySize)
+        : reads(memorySize >> LINE_BITS),
+          writes(memorySize >> LINE_BITS),
+          executes(memorySize >> LINE_BITS),
+          stamps(memorySize >> LINE_BITS),
+          dataBegin(0),
+          imageEnd(0)
+{
+    clear();
+}
+
+void m20::Heatmap::clear()
+{
+    std::fill(reads.begin(), reads.end(), 0);
+    std::fill(writes.begin(), writes.end(), 0);
+    std::fill(executes.begin(), executes.end(), 0);
+    std::fill(stamps.begin(), stamps.end(), 0);
+    series.clear();
+    std::fill(current, current + REGION_COUNT, 0);
+    executed = 0;
+    std::fill(lowestSp, lowestSp + MODE_COUNT, ~0u);
+    std::fill(highestSp, highestSp + MODE_COUNT, 0);
+}
+
+void m20::Heatmap::setLayout(unsigned int dataBegin, unsigned int imageEnd)
+{
+    this->dataBegin = std::min(dataBegin, imageEnd);
+    this->imageEnd = imageEnd;
+}
+
+void m20::Heatmap::closeWindow()
+{
+    series.insert(series.end(), current, current + REGION_COUNT);
+    std::fill(current, current + REGION_COUNT, 0);
+}
+
+void m20::Heatmap::print(std::ostream &os) const
+{
+    const unsigned int bounds[] = {
+            0, dataBegin, imageEnd, (unsigned int) stamps.size() << LINE_BITS
+    };
+
+    os << "Memory Heatmap -----------------\n"
+       << std::dec << LINE_BYTES << " byte lines\n"
+       << "region        bytes   lines touched       reads      writes"
+          "    executes\n";
+    for (unsigned int r = 0; r < REGION_COUNT; ++r)
+    {
+        size_t lines = 0;
+        size_t touched = 0;
+        size_t sums[3] = {};
+        for (size_t line = 0; line < stamps.size(); ++line)
+        {
+            if (getRegion((unsigned int) line << LINE_BITS) != r)
+            {
+                continue;
+            }
+            ++lines;
+            touched += getTotal(line) != 0;
+            sums[0] += reads[line];
+            sums[1] += writes[line];
+            sums[2] += executes[line];
+        }
+        os << "  " << std::setfill(' ') << std::left << std::setw(8)
+           << REGION_NAMES[r]
+           << std::right << std::setw(9) << bounds[r + 1] - bounds[r]
+           << std::setw(8) << touched << "/" << std::left << std::setw(7)
+           << lines << std::right;
+        for (const auto &sum : sums)
+        {
+            os << std::setw(12) << sum;
+        }
+        os << "\n";
+    }
+
+    // Hottest lines, most accesses first
+    std::vector<size_t> order;
+    for (size_t line = 0; line < stamps.size(); ++line)
+    {
+        if (getTotal(line) != 0)
+        {
+            order.push_back(line);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+    {
+        return getTotal(a) > getTotal(b);
+    });
+    os << "hottest lines:\n";
+    for (size_t i = 0; i < order.size() && i < MAX_LINES; ++i)
+    {
+        size_t line = order[i];
+        os << "  0x" << std::hex << std::setw(4) << std::setfill('0')
+           << (line << LINE_BITS) << std::dec << std::setfill(' ') << " "
+           << std::left << std::setw(6)
+           << REGION_NAMES[getRegion((unsigned int) line << LINE_BITS)]
+           << std::right << std::setw(11) << reads[line] << std::setw(12)
+           << writes[line] << std::setw(12) << executes[line] << "\n";
+    }
+
+    // One character per page, shaded by log(accesses) relative to the
+    // hottest page
+    size_t linesPerPage = (size_t) 1 << (PAGE_BITS - LINE_BITS);
+    std::vector<size_t> pages((stamps.size() + linesPerPage - 1)
+                              / linesPerPage);
+    for (size_t line = 0; line < stamps.size(); ++line)
+    {
+        pages[line / linesPerPage] += getTotal(line);
+    }
+    size_t hottest = pages.empty()
+                     ? 0 : *std::max_element(pages.begin(), pages.end());
+    os << "page map (" << (1 << PAGE_BITS) << " bytes per character, \""
+       << SHADES << "\"):\n";
+    for (size_t page = 0; page < pages.size(); page += MAP_WIDTH)
+    {
+        os << "  0x" << std::hex << std::setw(4) << std::setfill('0')
+           << (page << PAGE_BITS) << std::dec << std::setfill(' ') << " |";
+        for (size_t i = page; i < page + MAP_WIDTH && i < pages.size(); ++i)
+        {
+            unsigned int shade = 0;
+            if (pages[i] != 0)
+            {
+                shade = 1 + (unsigned int) ((SHADE_COUNT - 2)
+                                            * std::log((double) pages[i])
+                                            / std::log((double) std::max(
+                                                    hottest, (size_t) 2)));
+            }
+            os << SHADES[shade];
+        }
+        os << "|\n";
+    }
+
+    // Working set per window, merging neighbouring windows (keeping the
+    // largest count) so that at most MAX_WINDOWS rows are printed
+    std::vector<uint32_t> windows(series);
+    if (current[TEXT] + current[DATA] + current[STACK] != 0)
+    {
+        windows.insert(windows.end(), current, current + REGION_COUNT);
+    }
+    size_t count = windows.size() / REGION_COUNT;
+    size_t group = std::max((count + MAX_WINDOWS - 1) / MAX_WINDOWS,
+                            (size_t) 1);
+    os << "working set (peak lines touched per " << WINDOW
+       << " instructions):\n"
+       << "  instructions            text    data   stack\n";
+    for (size_t w = 0; w < count; w += group)
+    {
+        uint32_t peak[REGION_COUNT] = {};
+        for (size_t i = w; i < w + group && i < count; ++i)
+        {
+            for (unsigned int r = 0; r < REGION_COUNT; ++r)
+            {
+                peak[r] = std::max(peak[r], windows[i * REGION_COUNT + r]);
+            }
+        }
+        os << "  " << std::left << std::setw(20) << w * WINDOW << std::right;
+        for (const auto &lines : peak)
+        {
+            os << std::setw(8) << lines;
+        }
+        os << "\n";
+    }
+
+    os << "stack high-water:\n";
+    for (unsigned int mode = 0; mode < MODE_COUNT; ++mode)
+    {
+        if (lowestSp[mode] <= highestSp[mode])
+        {
+            os << "  mode " << MODE_NAMES[mode] << "  sp 0x" << std::hex
+               << highestSp[mode] << " down to 0x" << lowestSp[mode]
+               << std::dec << " (" << highestSp[mode] - lowestSp[mode]
+               << " bytes)\n";
+        }
+    }
+    for (size_t line = (imageEnd + LINE_BYTES - 1) >> LINE_BITS;
+         line < stamps.size(); ++line)
+    {
+        if (getTotal(line) != 0)
+        {
+            size_t lowest = line << LINE_BITS;
+            os << "  lowest stack access 0x" << std::hex << lowest
+               << std::dec << ", " << lowest - imageEnd
+               << " bytes above the image\n";
+            break;
+        }
+    }
+    os << "--------------------------------" << std::endl;
+}
+
+void m20::Heatmap::writeCsv(std::ostream &os) const
+{
+    os << "address,region,reads,writes,executes\n";
+    for (size_t line = 0; line < stamps.size(); ++line)
+    {
+        if (getTotal(line) != 0)
+        {
+            os << (line << LINE_BITS) << ","
+               << REGION_NAMES[getRegion((unsigned int) line << LINE_BITS)]
+               << "," << reads[line] << "," << writes[line] << ","
+               << executes[line] << "\n";
+        }
+    }
+}
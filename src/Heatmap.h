@@ -0,0 +1,144 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Guest memory access heatmap and working set of a simulator run.
+ * =============================================================================
+ */
+
+#ifndef M20_ASSEMBLY_HEATMAP_H
+#define M20_ASSEMBLY_HEATMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace m20
+{
+    /**
+     * Counts reads, writes and instruction fetches per cache line of guest
+     *  memory. Every access also stamps its line with the current window of
+     *  WINDOW instructions, which yields the number of distinct lines each
+     *  region touched per window (the working set over time). The lowest
+     *  stack pointer seen per mode gives the stack high-water mark.
+     */
+    class Heatmap
+    {
+    public:
+        static const unsigned int LINE_BITS = 5;
+        static const unsigned int LINE_BYTES = 1 << LINE_BITS;
+        static const unsigned int PAGE_BITS = 8;
+        static const size_t WINDOW = 10000;
+        static const unsigned int MODE_COUNT = 4;
+
+        enum Region
+        {
+            TEXT,
+            DATA,
+            STACK,
+            REGION_COUNT
+        };
+
+        explicit Heatmap(size_t memorySize);
+
+        void clear();
+
+        /**
+         * Sets the region boundaries: text is [0, dataBegin), data is
+         *  [dataBegin, imageEnd) and everything above the image is stack
+         */
+        void setLayout(unsigned int dataBegin, unsigned int imageEnd);
+
+        /**
+         * Records one executed instruction
+         * @param pc Address of the instruction
+         * @param mode Processor mode (low bits of st)
+         * @param sp Stack pointer of mode
+         */
+        void execute(unsigned int pc, unsigned int mode, unsigned int sp)
+        {
+            if (++executed % WINDOW == 0)
+            {
+                closeWindow();
+            }
+            touch(pc, 4, executes);
+            if (sp < lowestSp[mode])
+            {
+                lowestSp[mode] = sp;
+            }
+            if (sp > highestSp[mode])
+            {
+                highestSp[mode] = sp;
+            }
+        }
+
+        void read(unsigned int addr, unsigned int size)
+        {
+            touch(addr, size, reads);
+        }
+
+        void write(unsigned int addr, unsigned int size)
+        {
+            touch(addr, size, writes);
+        }
+
+        /**
+         * Prints per-region totals, the hottest lines, a page map, the
+         *  working set over time and the stack high-water marks
+         */
+        void print(std::ostream &os) const;
+
+        /**
+         * Writes address,region,reads,writes,executes for every touched line
+         */
+        void writeCsv(std::ostream &os) const;
+
+    private:
+        std::vector<uint32_t> reads;
+        std::vector<uint32_t> writes;
+        std::vector<uint32_t> executes;
+        std::vector<uint32_t> stamps;       // Last window + 1 per line
+        std::vector<uint32_t> series;       // [window][region] lines touched
+        uint32_t current[REGION_COUNT];
+        size_t executed;
+        unsigned int dataBegin;
+        unsigned int imageEnd;
+        unsigned int lowestSp[MODE_COUNT];
+        unsigned int highestSp[MODE_COUNT];
+
+        void touch(unsigned int addr, unsigned int size,
+                   std::vector<uint32_t> &counts)
+        {
+            size_t first = addr >> LINE_BITS;
+            size_t last = (addr + size - 1) >> LINE_BITS;
+            for (size_t line = first; line <= last && line < stamps.size();
+                 ++line)
+            {
+                ++counts[line];
+                auto stamp = (uint32_t) (executed / WINDOW + 1);
+                if (stamps[line] != stamp)
+                {
+                    stamps[line] = stamp;
+                    ++current[getRegion((unsigned int) line << LINE_BITS)];
+                }
+            }
+        }
+
+        Region getRegion(unsigned int addr) const
+        {
+            return addr < dataBegin ? TEXT : addr < imageEnd ? DATA : STACK;
+        }
+
+        void closeWindow();
+
+        uint32_t getTotal(size_t line) const
+        {
+            return reads[line] + writes[line] + executes[line];
+        }
+    };
+}
+
+#endif // M20_ASSEMBLY_HEATMAP_H
@@ -0,0 +1,146 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Dynamic instruction mix of a simulator run. (Implementation)
+ * =============================================================================
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+#include "Histogram.h"
+
+namespace
+{
+    const char *const FORMAT_NAMES[] = {
+            "data", "load", "branch", "coprocessor", "swi", "invalid"
+    };
+
+    const char *const DATA_NAMES[] = {
+            "noop", "add", "adc", "sub", "sbc", "mul", "div", "udv",
+            "or", "and", "xor", "nor", "bic", "ror", "lsl", "lsr",
+            "asr", "mov", "mvn", "cmp", "cmn", "tst", "teq", "push",
+            "pop", "srl", "srs", "data 0x1b", "data 0x1c", "data 0x1d",
+            "data 0x1e", "halt"
+    };
+
+    const char *const LOAD_NAMES[] = {
+            "ldr", "ldrb", "ldrh", "ldrsb", "ldrsh", "str", "strb", "strh",
+            "swp", "ldrex", "strex", "load 0xb", "load 0xc", "load 0xd",
+            "load 0xe", "load 0xf"
+    };
+
+    const char *const BRANCH_NAMES[] = {"b", "bwl"};
+
+    const char *const CONDITION_NAMES[] = {
+            "eq", "ne", "cs", "cc", "mi", "pl", "vs", "vc",
+            "hi", "ls", "ge", "lt", "gt", "le", "al", "invalid"
+    };
+
+    const unsigned int COND_AL = 0xE;
+    const unsigned int COND_INVALID = 0xF;
+}
+
+void m20::Histogram::clear()
+{
+    total = 0;
+    std::fill(formats, formats + FORMAT_COUNT, 0);
+    std::fill(data, data + DATA_COUNT, 0);
+    std::fill(loads, loads + LOAD_COUNT, 0);
+    std::fill(branches, branches + BRANCH_COUNT, 0);
+    std::fill(conditions, conditions + CONDITION_COUNT, 0);
+    taken = 0;
+    notTaken = 0;
+}
+
+void m20::Histogram::record(int instr, bool passed)
+{
+    auto cond = ((unsigned int) instr >> 28) & 0xF;
+
+    ++total;
+    ++conditions[cond];
+    if (cond == COND_INVALID)
+    {
+        ++formats[INVALID];
+        return;
+    }
+    if (cond != COND_AL)
+    {
+        ++(passed ? taken : notTaken);
+    }
+
+    if ((instr & 0x08000000) == 0)
+    {
+        ++formats[DATA];
+        ++data[(instr >> 20) & 0x1F];
+    }
+    else if ((instr & 0x04000000) == 0)
+    {
+        ++formats[LOAD];
+        ++loads[(instr >> 20) & 0xF];
+    }
+    else if ((instr & 0x02000000) == 0)
+    {
+        ++formats[BRANCH];
+        ++branches[(instr >> 24) & 0x1];
+    }
+    else if ((instr & 0x01000000) == 0)
+    {
+        ++formats[COPROCESSOR];
+    }
+    else
+    {
+        ++formats[SWI];
+    }
+}
+
+void m20::Histogram::print(std::ostream &os) const
+{
+    os << "Instruction Mix ----------------\n";
+    printSection(os, "format", formats, FORMAT_NAMES, FORMAT_COUNT);
+    printSection(os, "data opcode", data, DATA_NAMES, DATA_COUNT);
+    printSection(os, "load opcode", loads, LOAD_NAMES, LOAD_COUNT);
+    printSection(os, "branch opcode", branches, BRANCH_NAMES, BRANCH_COUNT);
+    printSection(os, "condition", conditions, CONDITION_NAMES,
+                 CONDITION_COUNT);
+
+    const size_t outcomes[] = {taken, notTaken};
+    const char *const OUTCOME_NAMES[] = {"passed", "failed"};
+    printSection(os, "conditional", outcomes, OUTCOME_NAMES, 2);
+    os << "--------------------------------" << std::endl;
+}
+
+void m20::Histogram::printSection(std::ostream &os, const char *title,
+                                  const size_t *counts,
+                                  const char *const *names,
+                                  size_t size) const
+{
+    // Most frequent first; ties keep table order
+    std::vector<size_t> order;
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (counts[i] != 0)
+        {
+            order.push_back(i);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [counts](size_t a, size_t b)
+    {
+        return counts[a] > counts[b];
+    });
+
+    os << title << ":\n";
+    for (const auto &i : order)
+    {
+        os << "  " << std::left << std::setw(16) << std::setfill(' ')
+           << names[i] << std::right << std::dec << std::setw(12)
+           << counts[i] << " (" << std::fixed << std::setprecision(1)
+           << std::setw(5) << (total > 0 ? 100.0 * counts[i] / total : 0.0)
+           << "%)\n";
+    }
+    os << std::defaultfloat << std::setprecision(6);
+}
@@ -0,0 +1,77 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Dynamic instruction mix of a simulator run.
+ * =============================================================================
+ */
+
+#ifndef M20_ASSEMBLY_HISTOGRAM_H
+#define M20_ASSEMBLY_HISTOGRAM_H
+
+#include <cstddef>
+#include <iostream>
+
+namespace m20
+{
+    /**
+     * Counts executed instruction words by format, opcode, condition code
+     *  and, for conditional instructions, whether the condition passed
+     */
+    class Histogram
+    {
+    public:
+        static const unsigned int FORMAT_COUNT = 6;
+        static const unsigned int DATA_COUNT = 32;
+        static const unsigned int LOAD_COUNT = 16;
+        static const unsigned int BRANCH_COUNT = 2;
+        static const unsigned int CONDITION_COUNT = 16;
+
+        Histogram()
+        {
+            clear();
+        }
+
+        void clear();
+
+        /**
+         * Records one issued instruction
+         * @param instr Instruction word
+         * @param passed Whether the condition of instr passed
+         */
+        void record(int instr, bool passed);
+
+        /**
+         * Prints every non-zero bucket with its share of the total
+         */
+        void print(std::ostream &os) const;
+
+    private:
+        enum Format
+        {
+            DATA,
+            LOAD,
+            BRANCH,
+            COPROCESSOR,
+            SWI,
+            INVALID
+        };
+
+        size_t total;
+        size_t formats[FORMAT_COUNT];
+        size_t data[DATA_COUNT];
+        size_t loads[LOAD_COUNT];
+        size_t branches[BRANCH_COUNT];
+        size_t conditions[CONDITION_COUNT];
+        size_t taken;
+        size_t notTaken;
+
+        void printSection(std::ostream &os, const char *title,
+                          const size_t *counts, const char *const *names,
+                          size_t size) const;
+    };
+}
+
+#endif // M20_ASSEMBLY_HISTOGRAM_H
@@ -0,0 +1,233 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Periodic checkpoints and deterministic replay for reverse execution.
+ *      (Implementation)
+ * =============================================================================
+ */
+
+#include <algorithm>
+
+#include "History.h"
+
+m20::History::History(Simulator &simulator, size_t interval, size_t budget)
+        : simulator(simulator),
+          interval(std::max(interval, (size_t) 1)),
+          budget(budget),
+          used(0),
+          next(0)
+{
+    //
+}
+
+void m20::History::reset()
+{
+    simulator.reset();
+    checkpoints.clear();
+    used = 0;
+    shadow.assign(simulator.getMemory(),
+                  simulator.getMemory() + simulator.getMemorySize());
+    simulator.clearDirtyPages();
+    take();
+}
+
+m20::Status m20::History::run(size_t steps)
+{
+    return forward(now() + std::min(steps, SIZE_MAX - now()));
+}
+
+bool m20::History::seek(size_t instruction)
+{
+    if (instruction < getOldest())
+    {
+        return false;
+    }
+    if (instruction < now())
+    {
+        size_t index = checkpoints.size() - 1;
+        while (checkpoints[index].state.instructionsExecuted > instruction)
+        {
+            --index;
+        }
+        rewind(index);
+    }
+    replay(instruction);
+    return true;
+}
+
+bool m20::History::reverseStep(size_t count)
+{
+    return count <= now() && seek(now() - count);
+}
+
+bool m20::History::runBackToWrite(unsigned int addr, size_t size,
+                                  WatchHit &hit)
+{
+    size_t end = now();
+    std::vector<size_t> starts;
+    for (const auto &checkpoint : checkpoints)
+    {
+        starts.push_back(checkpoint.state.instructionsExecuted);
+    }
+
+    // Replay the intervals from the newest down until one writes the range;
+    // its last write is the one we want
+    bool found = false;
+    size_t after = end;
+    for (size_t i = starts.size(); i-- > 0 && !found;)
+    {
+        if (starts[i] >= end)
+        {
+            continue;
+        }
+        if (!seek(starts[i]))
+        {
+            break;      // Dropped to stay within the budget meanwhile
+        }
+
+        simulator.clearWatchpoints();
+        if (!simulator.addWatchpoint(addr, size, Access::WRITE))
+        {
+            break;
+        }
+        size_t stop = i + 1 < starts.size() ? starts[i + 1] : end;
+        while (replay(stop) == Status::WATCHPOINT)
+        {
+            found = true;
+            after = now();
+            hit = simulator.getWatchHit();
+        }
+        simulator.clearWatchpoints();
+    }
+
+    seek(after);
+    return found;
+}
+
+m20::Status m20::History::forward(size_t target)
+{
+    while (now() < target)
+    {
+        Status status = simulator.run(std::min(target, next) - now());
+        if (now() >= next)
+        {
+            take();
+        }
+        if (status != Status::RUNNING)
+        {
+            return status;
+        }
+    }
+    return Status::RUNNING;
+}
+
+m20::Status m20::History::replay(size_t target)
+{
+    // Only the reference engine stops exactly at the target. Breakpoints
+    // were already reported on the way there.
+    Engine engine = simulator.getEngine();
+    simulator.setEngine(Engine::REFERENCE);
+    Status status;
+    do
+    {
+        status = forward(target);
+    } while (status == Status::BREAKPOINT);
+    simulator.setEngine(engine);
+    return status;
+}
+
+void m20::History::take()
+{
+    const char *memory = simulator.getMemory();
+    if (!checkpoints.empty())
+    {
+        // The previous checkpoint keeps what its interval overwrote
+        Checkpoint &previous = checkpoints.back();
+        for (const auto &page : simulator.getDirtyPages())
+        {
+            size_t begin = (size_t) page << Simulator::PAGE_BITS;
+            size_t end = std::min(begin + Simulator::PAGE_BYTES,
+                                  shadow.size());
+            previous.pages.push_back(page);
+            previous.contents.insert(previous.contents.end(),
+                                     shadow.begin() + begin,
+                                     shadow.begin() + end);
+            std::copy(memory + begin, memory + end, shadow.begin() + begin);
+        }
+        used += getSize(previous) - sizeof(Checkpoint);
+    }
+    simulator.clearDirtyPages();
+
+    checkpoints.emplace_back();
+    simulator.saveState(checkpoints.back().state);
+    used += sizeof(Checkpoint);
+    next = now() + interval;
+    trim();
+}
+
+void m20::History::rewind(size_t index)
+{
+    // Back to the newest checkpoint, then undo each interval down to index
+    std::vector<unsigned int> written(simulator.getDirtyPages());
+    for (const auto &page : written)
+    {
+        size_t begin = (size_t) page << Simulator::PAGE_BITS;
+        writePage(page, shadow.data() + begin);
+    }
+    for (size_t i = checkpoints.size() - 1; i-- > index;)
+    {
+        const Checkpoint &checkpoint = checkpoints[i];
+        const char *contents = checkpoint.contents.data();
+        for (const auto &page : checkpoint.pages)
+        {
+            size_t begin = (size_t) page << Simulator::PAGE_BITS;
+            size_t end = std::min(begin + Simulator::PAGE_BYTES,
+                                  shadow.size());
+            writePage(page, contents);
+            std::copy(contents, contents + (end - begin),
+                      shadow.begin() + begin);
+            contents += end - begin;
+        }
+    }
+
+    // The replay takes the later checkpoints again
+    while (checkpoints.size() > index + 1)
+    {
+        used -= getSize(checkpoints.back());
+        checkpoints.pop_back();
+    }
+    Checkpoint &checkpoint = checkpoints.back();
+    used -= getSize(checkpoint) - sizeof(Checkpoint);
+    checkpoint.pages.clear();
+    checkpoint.contents.clear();
+
+    simulator.loadState(checkpoint.state);
+    simulator.clearDirtyPages();
+    next = now() + interval;
+}
+
+void m20::History::trim()
+{
+    while (used > budget && checkpoints.size() > 1)
+    {
+        used -= getSize(checkpoints.front());
+        checkpoints.pop_front();
+    }
+}
+
+void m20::History::writePage(unsigned int page, const char *contents)
+{
+    size_t begin = (size_t) page << Simulator::PAGE_BITS;
+    size_t end = std::min(begin + Simulator::PAGE_BYTES, shadow.size());
+    simulator.writeMemory((unsigned int) begin, contents, end - begin);
+}
+
+size_t m20::History::getSize(const Checkpoint &checkpoint)
+{
+    return sizeof(Checkpoint)
+           + checkpoint.pages.size() * sizeof(unsigned int)
+           + checkpoint.contents.size();
+}
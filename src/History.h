@@ -0,0 +1,137 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Periodic checkpoints and deterministic replay for reverse execution.
+ * =============================================================================
+ */
+
+#ifndef M20_ASSEMBLY_HISTORY_H
+#define M20_ASSEMBLY_HISTORY_H
+
+#include <deque>
+#include <vector>
+
+#include "Simulator.h"
+
+namespace m20
+{
+    /**
+     * Runs a simulator forward while taking a checkpoint every interval
+     *  instructions, and moves it back in time by restoring the nearest
+     *  earlier checkpoint and replaying forward on the reference engine,
+     *  which stops on exact instruction counts. Execution is deterministic
+     *  on one core, so the replay reaches the same state.
+     *
+     * A checkpoint holds the processor state and, once the next one is
+     *  taken, the pages written in between as they were when it was taken.
+     *  Undoing the checkpoints from the newest down therefore rebuilds the
+     *  memory of any of them, and the cost of a checkpoint is the pages
+     *  written since the previous one. The oldest checkpoints are dropped to
+     *  keep their size within the budget.
+     *
+     * History takes over the simulator's dirty-page tracking, so it cannot
+     *  be combined with Simulator::checkpoint/restore, and the watchpoints
+     *  it arms to find writes replace the simulator's own.
+     */
+    class History
+    {
+    public:
+        static const size_t DEFAULT_INTERVAL = 100000;
+        static const size_t DEFAULT_BUDGET = 64 << 20;
+
+        /**
+         * @param interval Instructions between checkpoints
+         * @param budget Bytes the checkpoints may use
+         */
+        explicit History(Simulator &simulator,
+                         size_t interval = DEFAULT_INTERVAL,
+                         size_t budget = DEFAULT_BUDGET);
+
+        /**
+         * Resets the simulator and takes the first checkpoint
+         */
+        void reset();
+
+        /**
+         * Runs forward on the selected engine like Simulator::run, taking
+         *  checkpoints on the way
+         */
+        Status run(size_t steps);
+
+        /**
+         * Moves to the state after the given number of instructions. Going
+         *  forward replays at most to where the run stops.
+         * @return False if the instruction precedes the oldest checkpoint
+         */
+        bool seek(size_t instruction);
+
+        /**
+         * Moves back count instructions
+         * @return False if that precedes the oldest checkpoint
+         */
+        bool reverseStep(size_t count = 1);
+
+        /**
+         * Moves back to just after the last instruction that wrote to
+         *  [addr, addr + size)
+         * @param hit Receives the write (pc, old and new value)
+         * @return False (staying put) if no retained history wrote to it
+         */
+        bool runBackToWrite(unsigned int addr, size_t size, WatchHit &hit);
+
+        size_t getCheckpointCount() const
+        {
+            return checkpoints.size();
+        }
+
+        /**
+         * Returns the bytes the checkpoints use
+         */
+        size_t getMemoryUsed() const
+        {
+            return used;
+        }
+
+        /**
+         * Returns the earliest instruction count seek() can reach
+         */
+        size_t getOldest() const
+        {
+            return checkpoints.front().state.instructionsExecuted;
+        }
+
+    private:
+        struct Checkpoint
+        {
+            ProcessorState state;
+            std::vector<unsigned int> pages;    // Written before the next
+            std::vector<char> contents;         // Those pages at this one
+        };
+
+        Simulator &simulator;
+        size_t interval;
+        size_t budget;
+        std::deque<Checkpoint> checkpoints;
+        std::vector<char> shadow;       // Memory at the newest checkpoint
+        size_t used;
+        size_t next;                    // Instruction of the next checkpoint
+
+        size_t now() const
+        {
+            return simulator.getInstructionsExecuted();
+        }
+
+        Status forward(size_t target);
+        Status replay(size_t target);
+        void take();
+        void rewind(size_t index);
+        void trim();
+        void writePage(unsigned int page, const char *contents);
+        static size_t getSize(const Checkpoint &checkpoint);
+    };
+}
+
+#endif // M20_ASSEMBLY_HISTORY_H
@@ -56,6 +56,9 @@ namespace m20
         STR,
         STRH,
         STRB,
+        SWP,
+        LDREX,
+        STREX,
         SWI,
         HALT
     };
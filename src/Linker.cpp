@@ -8,9 +8,12 @@
  * =============================================================================
  */
 
+#include <algorithm>
+#include <cctype>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <tuple>
 
 #include "Linker.h"
 
@@ -85,6 +88,8 @@ bool m20::Linker::link(const std::vector<const std::string> &files,
         fixupSection(i);
     }
 
+    writeSymbols(executable + ".sym");
+
     // Cleanup heap memory
     for (auto &section : sections)
     {
@@ -437,6 +442,45 @@ int m20::Linker::getImmediate(unsigned int addr,
     return offset & mask;
 }
 
+void m20::Linker::writeSymbols(const std::string &fname)
+{
+    std::vector<std::tuple<unsigned int, char, std::string>> entries;
+    for (const auto &fileSymbols : symbols)
+    {
+        for (const auto &symbol : fileSymbols.second)
+        {
+            const Section &section = sections[symbol.section];
+            if (symbol.type == SymbolType::UNDEFINED
+                || section.file != fileSymbols.first)
+            {
+                continue;
+            }
+
+            char type = section.text ? 'T' : 'D';
+            if (symbol.type == SymbolType::LOCAL)
+            {
+                type = (char) std::tolower(type);
+            }
+            entries.emplace_back(section.address
+                                 + (symbol.address - section.begin),
+                                 type, symbol.label);
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+
+    std::ofstream outfile(fname);
+    assert(outfile.is_open());
+
+    for (const auto &entry : entries)
+    {
+        outfile << std::hex << std::setw(8) << std::setfill('0')
+                << std::get<0>(entry) << " " << std::get<1>(entry) << " "
+                << std::get<2>(entry) << "\n";
+    }
+
+    outfile.close();
+}
+
 void m20::Linker::printErrors()
 {
     for (const auto &error : errors)
@@ -170,6 +170,13 @@ namespace m20
                          unsigned int label,
                          InstructionType type);
 
+        /**
+         * Writes the final address, kind and name of every symbol, one per
+         *  line and sorted by address. Kinds follow nm: T/t for text, D/d
+         *  for data, upper case for globals.
+         */
+        void writeSymbols(const std::string &fname);
+
         void printErrors();
     };
 }
@@ -0,0 +1,119 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Symmetric multiprocessor of simulator cores sharing guest memory.
+ *      (Implementation)
+ * =============================================================================
+ */
+
+#include <atomic>
+#include <cassert>
+#include <thread>
+
+#include "Multiprocessor.h"
+
+m20::Multiprocessor::Multiprocessor(size_t memorySize, unsigned int count)
+        : statuses(count, Status::RUNNING)
+{
+    assert(count >= 1 && count <= Simulator::MAX_CORES);
+    cores.emplace_back(new Simulator(memorySize));
+    for (unsigned int id = 1; id < count; ++id)
+    {
+        cores.emplace_back(new Simulator(*cores[0], id));
+    }
+}
+
+m20::Multiprocessor::~Multiprocessor()
+{
+    // Core 0 owns the memory the others use
+    while (!cores.empty())
+    {
+        cores.pop_back();
+    }
+}
+
+bool m20::Multiprocessor::load(const std::string &fname)
+{
+    if (!cores[0]->load(fname))
+    {
+        return false;
+    }
+    for (size_t id = 1; id < cores.size(); ++id)
+    {
+        cores[id]->attach();
+    }
+    return true;
+}
+
+void m20::Multiprocessor::reset()
+{
+    for (auto &core : cores)
+    {
+        core->reset();
+    }
+    std::fill(statuses.begin(), statuses.end(), Status::RUNNING);
+}
+
+m20::Status m20::Multiprocessor::run()
+{
+    // Cores run in quanta and poll this flag in between, so stopping costs
+    // nothing inside the engines
+    std::atomic<bool> stopped(false);
+    std::vector<std::thread> threads;
+
+    for (size_t id = 0; id < cores.size(); ++id)
+    {
+        threads.emplace_back([this, id, &stopped]()
+        {
+            Simulator &core = *cores[id];
+            Status status;
+            do
+            {
+                status = core.run(QUANTUM);
+
+                // A core waiting in an idle loop skipped the rest of its
+                // quantum; give its host thread to a core doing work
+                if (core.isIdle())
+                {
+                    std::this_thread::yield();
+                }
+            } while (status == Status::RUNNING
+                     && !stopped.load(std::memory_order_relaxed));
+
+            statuses[id] = status;
+            if (id == 0)
+            {
+                stopped = true;
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    return statuses[0];
+}
+
+void m20::Multiprocessor::simulate(std::ostream &out)
+{
+    reset();
+    Status status = run();
+    cores[0]->report(status);
+    for (size_t id = 1; id < cores.size(); ++id)
+    {
+        const Simulator &core = *cores[id];
+        out << "Core " << std::dec << id << ": " << getStatusName(statuses[id])
+            << " after " << core.getInstructionsExecuted()
+                            - core.getInstructionsSkipped()
+            << " instructions";
+        if (core.getInstructionsSkipped() != 0)
+        {
+            out << " (" << core.getInstructionsSkipped()
+                << " skipped in idle loops)";
+        }
+        out << std::endl;
+    }
+}
@@ -0,0 +1,90 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Symmetric multiprocessor of simulator cores sharing guest memory.
+ * =============================================================================
+ */
+
+#ifndef M20_ASSEMBLY_MULTIPROCESSOR_H
+#define M20_ASSEMBLY_MULTIPROCESSOR_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Simulator.h"
+
+namespace m20
+{
+    /**
+     * Runs N cores on one guest memory, each on its own host thread. Every
+     *  core starts at address 0 in supervisor mode with its own stack
+     *  (Simulator::CORE_STACK_BYTES below the previous core's) and reads
+     *  its number from the cid status register.
+     *
+     * Memory model: aligned word loads and stores are single-copy atomic,
+     *  loads with acquire and stores with release ordering, so a word flag
+     *  written after the data it guards publishes that data to other cores.
+     *  Byte and halfword accesses are not atomic. swp, ldrex and strex are
+     *  read-modify-writes of aligned words with acquire-release ordering,
+     *  mapped onto host atomics, so guest locks work across cores. Decoded
+     *  instructions are cached per core. A store into a page that another
+     *  core holds decoded or translated code for is queued to that core,
+     *  which drops the entries for the word before its next step, so code
+     *  written by one core and published with a flag runs patched on the
+     *  core that acquires the flag, on every engine.
+     */
+    class Multiprocessor
+    {
+    public:
+        static const size_t QUANTUM = 10000;    // Instructions between polls
+
+        /**
+         * @param memorySize Size of guest memory in bytes
+         * @param count Number of cores, 1 to Simulator::MAX_CORES
+         */
+        Multiprocessor(size_t memorySize, unsigned int count);
+
+        ~Multiprocessor();
+
+        Simulator &getCore(unsigned int id)
+        {
+            return *cores[id];
+        }
+
+        unsigned int getCoreCount() const
+        {
+            return (unsigned int) cores.size();
+        }
+
+        /**
+         * Loads an executable into the shared memory for all cores
+         */
+        bool load(const std::string &fname);
+
+        void reset();
+
+        /**
+         * Runs every core on its own thread until core 0 stops. Other cores
+         *  run until they stop themselves or core 0 stops, whichever comes
+         *  first.
+         * @return Status of core 0
+         */
+        Status run();
+
+        /**
+         * Resets, runs and reports core 0 followed by a line per other core
+         */
+        void simulate(std::ostream &out = std::cout);
+
+    private:
+        std::vector<std::unique_ptr<Simulator>> cores;
+        std::vector<Status> statuses;
+    };
+}
+
+#endif // M20_ASSEMBLY_MULTIPROCESSOR_H
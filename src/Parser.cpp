@@ -559,6 +559,26 @@ unsigned int m20::Parser::parseRegister(const std::string &str,
         {
             return 1;
         }
+        else if (str == "ic")
+        {
+            return 2;
+        }
+        else if (str == "ich")
+        {
+            return 3;
+        }
+        else if (str == "cid")
+        {
+            return 4;
+        }
+        else if (str == "ipi")
+        {
+            return 5;
+        }
+        else if (str == "far")
+        {
+            return 6;
+        }
         else
         {
             errors.emplace_back(M20ErrorType::SYNTAX, getCurrent(),
@@ -867,6 +887,18 @@ m20::Instruction m20::Parser::getMem(const m20::Token &command)
     {
         instr.command = InstructionCommand::STRB;
     }
+    else if (streqi(command.raw, "swp"))
+    {
+        instr.command = InstructionCommand::SWP;
+    }
+    else if (streqi(command.raw, "ldrex"))
+    {
+        instr.command = InstructionCommand::LDREX;
+    }
+    else if (streqi(command.raw, "strex"))
+    {
+        instr.command = InstructionCommand::STREX;
+    }
     else
     {
         assert(false);
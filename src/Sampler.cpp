@@ -0,0 +1,176 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Statistical profiler sampling the guest PC on SIGPROF.
+ *      (Implementation)
+ * =============================================================================
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+#include <sys/time.h>
+
+#include "Sampler.h"
+
+namespace
+{
+    const unsigned int MODE_COUNT = 4;
+    const char *const MODE_NAMES[] = {"usr", "svr", "int", "abt"};
+    const size_t MAX_ROWS = 20;
+}
+
+std::atomic<m20::Sampler *> m20::Sampler::active(nullptr);
+
+m20::Sampler::Sampler(Simulator &simulator)
+        : simulator(simulator),
+          counts(MODE_COUNT * (simulator.getMemorySize() / 4), 0),
+          words(simulator.getMemorySize() / 4),
+          outside(0),
+          previous(),
+          running(false)
+{
+    //
+}
+
+m20::Sampler::~Sampler()
+{
+    stop();
+}
+
+bool m20::Sampler::start(unsigned int interval)
+{
+    Sampler *expected = nullptr;
+    if (running || !active.compare_exchange_strong(expected, this))
+    {
+        return false;
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = &Sampler::handle;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    struct itimerval timer = {};
+    timer.it_interval.tv_sec = interval / 1000000;
+    timer.it_interval.tv_usec = interval % 1000000;
+    timer.it_value = timer.it_interval;
+
+    if (sigaction(SIGPROF, &action, &previous) != 0)
+    {
+        active = nullptr;
+        return false;
+    }
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0)
+    {
+        sigaction(SIGPROF, &previous, nullptr);
+        active = nullptr;
+        return false;
+    }
+
+    running = true;
+    return true;
+}
+
+void m20::Sampler::stop()
+{
+    if (!running)
+    {
+        return;
+    }
+
+    struct itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    sigaction(SIGPROF, &previous, nullptr);
+    active = nullptr;
+    running = false;
+}
+
+void m20::Sampler::handle(int)
+{
+    Sampler *sampler = active.load(std::memory_order_relaxed);
+    if (sampler == nullptr)
+    {
+        return;
+    }
+
+    const Registers &regs = sampler->simulator.getRegisters();
+    auto pc = (unsigned int) regs.pc;
+    auto mode = (unsigned int) regs.st & 0x3;
+    if ((pc & 3) != 0 || pc / 4 >= sampler->words)
+    {
+        sampler->outside = sampler->outside + 1;
+        return;
+    }
+    ++sampler->counts[mode * sampler->words + pc / 4];
+}
+
+void m20::Sampler::print(std::ostream &os, const SymbolMap &symbols) const
+{
+    size_t total = outside;
+    size_t modes[MODE_COUNT] = {};
+    std::map<std::string, size_t> locations;
+
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        if (counts[i] == 0)
+        {
+            continue;
+        }
+        total += counts[i];
+        modes[i / words] += counts[i];
+
+        auto address = (unsigned int) (i % words * 4);
+        const SymbolMap::Entry *entry = symbols.find(address);
+        if (entry != nullptr)
+        {
+            locations[entry->name] += counts[i];
+        }
+        else
+        {
+            std::ostringstream ss;
+            ss << "0x" << std::hex << std::setw(8) << std::setfill('0')
+               << address;
+            locations[ss.str()] += counts[i];
+        }
+    }
+
+    std::vector<std::pair<std::string, size_t>> rows(locations.begin(),
+                                                     locations.end());
+    std::stable_sort(rows.begin(), rows.end(),
+                     [](const std::pair<std::string, size_t> &a,
+                        const std::pair<std::string, size_t> &b)
+                     {
+                         return a.second > b.second;
+                     });
+
+    os << "Profile ------------------------\n"
+       << std::dec << total << " samples\n";
+    for (size_t i = 0; i < rows.size() && i < MAX_ROWS; ++i)
+    {
+        os << "  " << std::left << std::setw(24) << std::setfill(' ')
+           << rows[i].first << std::right << std::setw(10) << rows[i].second
+           << " (" << std::fixed << std::setprecision(1) << std::setw(5)
+           << 100.0 * rows[i].second / total << "%)\n";
+    }
+    for (unsigned int i = 0; i < MODE_COUNT; ++i)
+    {
+        if (modes[i] != 0)
+        {
+            os << "  mode " << std::left << std::setw(19) << MODE_NAMES[i]
+               << std::right << std::setw(10) << modes[i] << "\n";
+        }
+    }
+    if (outside != 0)
+    {
+        os << "  " << std::left << std::setw(24) << "pc out of memory"
+           << std::right << std::setw(10) << outside << "\n";
+    }
+    os << std::defaultfloat << std::setprecision(6)
+       << "--------------------------------" << std::endl;
+}
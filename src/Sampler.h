@@ -0,0 +1,76 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Statistical profiler sampling the guest PC on SIGPROF.
+ * =============================================================================
+ */
+
+#ifndef M20_ASSEMBLY_SAMPLER_H
+#define M20_ASSEMBLY_SAMPLER_H
+
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "Simulator.h"
+#include "SymbolMap.h"
+
+namespace m20
+{
+    /**
+     * Samples the guest PC and mode of a simulator from a SIGPROF interval
+     *  timer. The signal handler only increments a preallocated counter per
+     *  (mode, word address), so it never allocates or locks, and the cost
+     *  is one signal per interval. Only one sampler can run at a time.
+     */
+    class Sampler
+    {
+    public:
+        static const unsigned int DEFAULT_INTERVAL = 1000;
+
+        explicit Sampler(Simulator &simulator);
+
+        ~Sampler();
+
+        Sampler(const Sampler &) = delete;
+        Sampler &operator=(const Sampler &) = delete;
+
+        /**
+         * Installs the SIGPROF handler and starts the interval timer
+         * @param interval Sampling interval in microseconds of CPU time
+         * @return False if another sampler is running or the timer could
+         *  not be started
+         */
+        bool start(unsigned int interval = DEFAULT_INTERVAL);
+
+        /**
+         * Stops the timer and restores the previous SIGPROF handler
+         */
+        void stop();
+
+        /**
+         * Prints samples per symbol (or per address if symbols is empty)
+         *  and per mode, most frequent first
+         */
+        void print(std::ostream &os, const SymbolMap &symbols) const;
+
+    private:
+        static std::atomic<Sampler *> active;
+
+        Simulator &simulator;
+        std::vector<uint32_t> counts;   // [mode][address / 4]
+        size_t words;
+        volatile uint32_t outside;      // PC outside of memory or unaligned
+        struct sigaction previous;
+        bool running;
+
+        static void handle(int signal);
+    };
+}
+
+#endif // M20_ASSEMBLY_SAMPLER_H
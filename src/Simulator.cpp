@@ -8,251 +8,1610 @@
  * =============================================================================
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "Simulator.h"
 
 const std::string m20::Bios::CSI = "\x1B[";
 
-void m20::Simulator::load(const std::string &fname)
+namespace
+{
+    const char *const STATUS_NAMES[] = {
+            "running",
+            "halted",
+            "undefined instruction",
+            "prefetch abort",
+            "data abort",
+            "usage abort",
+            "undefined interrupt",
+            "watchpoint",
+            "breakpoint",
+            "idle loop"
+    };
+}
+
+const char *m20::getStatusName(Status status)
+{
+    return STATUS_NAMES[(int) status];
+}
+
+m20::Simulator::Simulator(size_t memorySize)
+        : MAX_ADDRESS(memorySize - 1),
+          mem(nullptr),
+          mappedSize(roundToPage(memorySize)),
+          instructionsExecuted(0),
+          instructionsSkipped(0),
+          idle(false),
+          stopAt(0),
+          runTime(),
+          out(&std::cout),
+          dirty((memorySize + PAGE_BYTES - 1) / PAGE_BYTES),
+          engine(Engine::PREDECODED),
+          fusion(true),
+          decoded((memorySize + 3) / 4),
+          fusionHits(),
+          idleInstructions(0),
+          histogramEnabled(false),
+          translated((memorySize + 3) / 4, nullptr),
+          codePages((memorySize + PAGE_BYTES - 1) / PAGE_BYTES, 0),
+          dormant((memorySize + 3) / 4, nullptr),
+          tiers((memorySize + 3) / 4, Engine::REFERENCE),
+          heat((memorySize + 3) / 4, 0),
+          coldNext(-1),
+          predecodeThreshold(PREDECODE_THRESHOLD),
+          translateThreshold(TRANSLATE_THRESHOLD),
+          tierInstructions(),
+          watchedPages((memorySize + PAGE_BYTES - 1) / PAGE_BYTES, 0),
+          watchHit(),
+          watchTriggered(false),
+          heatmapEnabled(false),
+          heatmap(memorySize),
+          observed(false),
+          callGraphEnabled(false),
+          breakpoints((memorySize + 3) / 4, 0),
+          breakpointCount(0),
+          breakpointHit(false),
+          resumeCount(0),
+          imageSize(0),
+          primary(this),
+          coreId(0),
+          cores(1, this),
+          interrupts(0),
+          sharedCode(nullptr),
+          codeWritten(false),
+          exclusive(false),
+          exclusiveAddress(0),
+          exclusiveValue(0),
+          vectoring(false),
+          pending(Status::RUNNING),
+          faultPc(0),
+          faultCount(0),
+          faultAddress(0)
+{
+    void *pages = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pages == MAP_FAILED)
+    {
+        throw std::bad_alloc();
+    }
+    mem = static_cast<char *>(pages);
+}
+
+m20::Simulator::Simulator(Simulator &primary, unsigned int coreId)
+        : MAX_ADDRESS(primary.MAX_ADDRESS),
+          mem(primary.mem),
+          mappedSize(0),
+          instructionsExecuted(0),
+          instructionsSkipped(0),
+          idle(false),
+          stopAt(0),
+          runTime(),
+          out(primary.out),
+          dirty(primary.dirty.size()),
+          engine(primary.engine),
+          fusion(primary.fusion),
+          decoded(primary.decoded.size()),
+          fusionHits(),
+          idleInstructions(0),
+          histogramEnabled(false),
+          translated(primary.translated.size(), nullptr),
+          codePages(primary.codePages.size(), 0),
+          dormant(primary.dormant.size(), nullptr),
+          tiers(primary.tiers.size(), Engine::REFERENCE),
+          heat(primary.heat.size(), 0),
+          coldNext(-1),
+          predecodeThreshold(primary.predecodeThreshold),
+          translateThreshold(primary.translateThreshold),
+          tierInstructions(),
+          watchedPages(primary.watchedPages.size(), 0),
+          watchHit(),
+          watchTriggered(false),
+          heatmapEnabled(false),
+          heatmap((size_t) MAX_ADDRESS + 1),
+          observed(false),
+          callGraphEnabled(false),
+          breakpoints(primary.breakpoints.size(), 0),
+          breakpointCount(0),
+          breakpointHit(false),
+          resumeCount(0),
+          imageSize(0),
+          primary(&primary),
+          coreId(coreId),
+          interrupts(0),
+          sharedCode(nullptr),
+          codeWritten(false),
+          exclusive(false),
+          exclusiveAddress(0),
+          exclusiveValue(0),
+          vectoring(primary.vectoring),
+          pending(Status::RUNNING),
+          faultPc(0),
+          faultCount(0),
+          faultAddress(0)
+{
+    assert(primary.primary == &primary && coreId < MAX_CORES);
+    if (primary.cores.size() <= coreId)
+    {
+        primary.cores.resize(coreId + 1, nullptr);
+    }
+    primary.cores[coreId] = this;
+
+    // From now on stores into code are passed on between cores
+    if (primary.sharedCode == nullptr)
+    {
+        primary.codeCores.assign(primary.codePages.size(), 0);
+        for (size_t page = 0; page < primary.codePages.size(); ++page)
+        {
+            primary.codeCores[page] = primary.codePages[page] != 0 ? 1 : 0;
+        }
+        primary.sharedCode = primary.codeCores.data();
+    }
+    sharedCode = primary.sharedCode;
+}
+
+m20::Simulator::~Simulator()
+{
+    if (primary == this)
+    {
+        munmap(mem, mappedSize);
+    }
+    else
+    {
+        primary->cores[coreId] = nullptr;
+    }
+}
+
+bool m20::Simulator::load(const std::string &fname)
+{
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        *out << "Cannot open " << fname << std::endl;
+        return false;
+    }
+
+    struct stat info = {};
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        *out << "Cannot read " << fname << std::endl;
+        close(fd);
+        return false;
+    }
+
+    auto size = (size_t) info.st_size;
+    if (size > (size_t) MAX_ADDRESS + 1)
+    {
+        *out << fname << ": image of " << size << " bytes does not fit "
+             << "in " << (size_t) MAX_ADDRESS + 1 << " bytes of memory"
+             << std::endl;
+        close(fd);
+        return false;
+    }
+
+    // Replace the previous image with zeroed pages, then copy the file over
+    // the start of memory. Mapping the file itself would leave unwritten
+    // pages backed by it, so rebuilding the executable during a run would
+    // change guest code or fault.
+    if (mmap(mem, mappedSize, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+    {
+        *out << "Cannot map memory for " << fname << std::endl;
+        close(fd);
+        return false;
+    }
+    size_t done = 0;
+    while (done < size)
+    {
+        ssize_t count = pread(fd, mem + done, size - done, (off_t) done);
+        if (count <= 0)
+        {
+            break;      // Error, or the file shrank since fstat
+        }
+        done += (size_t) count;
+    }
+    close(fd);
+
+    if (done < size)
+    {
+        *out << "Cannot read " << fname << std::endl;
+        return false;
+    }
+
+    analyze(size);
+    return true;
+}
+
+bool m20::Simulator::load(const char *image, size_t size)
+{
+    if (size > (size_t) MAX_ADDRESS + 1)
+    {
+        *out << "Image of " << size << " bytes does not fit in "
+             << (size_t) MAX_ADDRESS + 1 << " bytes of memory"
+             << std::endl;
+        return false;
+    }
+    std::copy(image, image + size, mem);
+
+    analyze(size);
+    return true;
+}
+
+void m20::Simulator::attach()
+{
+    analyze(primary->imageSize);
+}
+
+void m20::Simulator::setTranslation(const TranslatedBlock *blocks,
+                                    size_t count)
+{
+    std::fill(translated.begin(), translated.end(), nullptr);
+    std::fill(dormant.begin(), dormant.end(), nullptr);
+    translatedHead.assign(translated.size(), -1);
+    for (auto &page : codePages)
+    {
+        page &= (uint8_t) ~CODE_TRANSLATED;
+    }
+
+    auto &installed = engine == Engine::TIERED ? dormant : translated;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const TranslatedBlock &block = blocks[i];
+        assert(block.begin % 4 == 0 && block.end <= MAX_ADDRESS + 1);
+        installed[block.begin >> 2] = block.run;
+        for (unsigned int addr = block.begin; addr < block.end; addr += 4)
+        {
+            translatedHead[addr >> 2] = (int) (block.begin >> 2);
+            markCode(addr >> PAGE_BITS, CODE_TRANSLATED);
+        }
+    }
+    if (engine != Engine::TIERED)
+    {
+        engine = Engine::TRANSLATED;
+    }
+}
+
+void m20::Simulator::reset()
+{
+    restart();
+    if (primary != this)
+    {
+        return;     // The screen belongs to core 0
+    }
+
+    // Initialize BIOS
+    for (unsigned int i = 0; i < Bios::WIDTH * Bios::HEIGHT; ++i)
+    {
+        bios.write(0);
+    }
+    bios.setCursor(0);
+    bios.flush();
+}
+
+void m20::Simulator::checkpoint()
+{
+    baseline.assign(mem, mem + MAX_ADDRESS + 1);
+    clearDirtyPages();
+}
+
+void m20::Simulator::clearDirtyPages()
+{
+    for (const auto &page : dirtyPages)
+    {
+        dirty[page] = false;
+    }
+    dirtyPages.clear();
+}
+
+void m20::Simulator::saveState(ProcessorState &state) const
+{
+    state.regs = regs;
+    state.instructionsExecuted = instructionsExecuted;
+    state.instructionsSkipped = instructionsSkipped;
+    state.halt = halt;
+    state.status = status;
+    state.exclusive = exclusive;
+    state.exclusiveAddress = exclusiveAddress;
+    state.exclusiveValue = exclusiveValue;
+    state.faultAddress = faultAddress;
+    state.interrupts = interrupts.load();
+    state.bios = bios;
+}
+
+void m20::Simulator::loadState(const ProcessorState &state)
+{
+    regs = state.regs;
+    instructionsExecuted = state.instructionsExecuted;
+    instructionsSkipped = state.instructionsSkipped;
+    halt = state.halt;
+    status = state.status;
+    exclusive = state.exclusive;
+    exclusiveAddress = state.exclusiveAddress;
+    exclusiveValue = state.exclusiveValue;
+    faultAddress = state.faultAddress;
+    interrupts.store(state.interrupts);
+    bios = state.bios;
+    bios.setOutput(*out);
+}
+
+void m20::Simulator::restore()
+{
+    assert(!baseline.empty());
+    for (const auto &page : dirtyPages)
+    {
+        size_t begin = (size_t) page << PAGE_BITS;
+        size_t end = std::min(begin + PAGE_BYTES, baseline.size());
+        std::copy(baseline.begin() + begin, baseline.begin() + end,
+                  mem + begin);
+        for (size_t addr = begin; codePages[page] != 0 && addr < end;
+             addr += 4)
+        {
+            invalidate((int) addr);     // Only pages that hold code
+        }
+        dirty[page] = false;
+    }
+    dirtyPages.clear();
+
+    restart();
+    bios.setCursor(0);
+}
+
+m20::Status m20::Simulator::run(size_t steps)
+{
+    auto begin = std::chrono::steady_clock::now();
+    Status result = dispatch(steps);
+    runTime += std::chrono::steady_clock::now() - begin;
+    return result;
+}
+
+m20::Status m20::Simulator::dispatch(size_t steps)
 {
-    std::ifstream infile(fname, std::ios::ate | std::ios::binary);
-    assert(infile.is_open());
-    int64_t size = infile.tellg();
-    infile.seekg(0);
-    infile.read(mem, size);
-    infile.close();
+    stopAt = instructionsExecuted
+             + std::min(steps, SIZE_MAX - instructionsExecuted);
+
+    watchTriggered = false;
+    breakpointHit = false;
+    idle = false;
+    resumeCount = instructionsExecuted;
+
+    while (!halt && instructionsExecuted < stopAt)
+    {
+        try
+        {
+            bool translatedRun = engine == Engine::TRANSLATED
+                                 || (engine == Engine::TIERED
+                                     && !translatedHead.empty());
+            if (histogramEnabled || heatmapEnabled || callGraphEnabled
+                || (!watchpoints.empty() && translatedRun)
+                || (breakpointCount != 0 && engine == Engine::REFERENCE))
+            {
+                // The other engines find breakpoints in the decoded stream.
+                // Translated blocks run on past a watchpoint hit, while
+                // predecoded sequences end at the accessing instruction.
+                while (!halt && instructionsExecuted < stopAt
+                       && !atBreakpoint())
+                {
+                    step();
+                }
+            }
+            else if (translatedRun)
+            {
+                while (!halt && instructionsExecuted < stopAt)
+                {
+                    stepTranslated();
+                }
+            }
+            else if (engine == Engine::PREDECODED || engine == Engine::TIERED)
+            {
+                while (!halt && instructionsExecuted < stopAt)
+                {
+                    stepPredecoded();
+                }
+            }
+            else
+            {
+                while (!halt && instructionsExecuted < stopAt)
+                {
+                    step();
+                }
+            }
+        }
+        catch (const DataAbortException &e)
+        {
+            raise(Status::DATA_ABORT);
+        }
+        catch (const UsageAbortException &e)
+        {
+            raise(Status::USAGE_ABORT);
+        }
+        catch (...)
+        {
+            return stop(Status::UNDEFINED_INTERRUPT);
+        }
+
+        // Exceptions (raised or thrown) stop the loops above with halt set
+        if (pending != Status::RUNNING && !takeException())
+        {
+            return status;
+        }
+    }
+
+    if (halt && status == Status::RUNNING)
+    {
+        status = Status::HALTED;
+    }
+    if (!halt && watchTriggered)
+    {
+        return Status::WATCHPOINT;
+    }
+    if (!halt && breakpointHit)
+    {
+        return Status::BREAKPOINT;
+    }
+    return status;
+}
+
+bool m20::Simulator::addWatchpoint(unsigned int addr, size_t size,
+                                   Access access)
+{
+    if (size == 0 || addr > MAX_ADDRESS || size - 1 > MAX_ADDRESS - addr)
+    {
+        return false;
+    }
+
+    unsigned int end = addr + (unsigned int) size;
+    watchpoints.push_back({addr, end, access});
+    observed = true;
+    for (unsigned int page = addr >> PAGE_BITS;
+         page <= (end - 1) >> PAGE_BITS; ++page)
+    {
+        watchedPages[page] |= (uint8_t) access;
+    }
+    return true;
+}
+
+void m20::Simulator::clearWatchpoints()
+{
+    watchpoints.clear();
+    observed = heatmapEnabled;
+    std::fill(watchedPages.begin(), watchedPages.end(), 0);
+}
+
+bool m20::Simulator::takeException()
+{
+    Status exception = pending;
+    pending = Status::RUNNING;
+    instructionsExecuted = faultCount;      // The instruction did not retire
+    if (!vectoring || getMode() == 3)
+    {
+        stop(exception);
+        return false;
+    }
+
+    int index = 0;
+    switch (exception)
+    {
+        case Status::UNDEFINED_INSTRUCTION:
+            index = UndefinedInstructionException::INDEX;
+            break;
+        case Status::PREFETCH_ABORT:
+            index = PrefetchAbortException::INDEX;
+            break;
+        case Status::DATA_ABORT:
+            index = DataAbortException::INDEX;
+            break;
+        default:
+            index = UsageAbortException::INDEX;
+            break;
+    }
+
+    // Like any exception entry, this breaks an ldrex/strex pair
+    exclusive = false;
+    halt = false;
+    regs.sv[3] = regs.st;
+    regs.st = (regs.st & ~MODE_ABT) | MODE_ABT;
+    regs.lp[3] = faultPc;
+    regs.pc = index;
+    return true;
+}
+
+bool m20::Simulator::addBreakpoint(unsigned int addr)
+{
+    if ((addr & 3) != 0 || addr > MAX_ADDRESS - 3)
+    {
+        return false;
+    }
+    if (breakpoints[addr >> 2] == 0)
+    {
+        breakpoints[addr >> 2] = 1;
+        ++breakpointCount;
+        invalidate((int) addr);
+    }
+    return true;
+}
+
+bool m20::Simulator::removeBreakpoint(unsigned int addr)
+{
+    if ((addr & 3) != 0 || addr > MAX_ADDRESS - 3
+        || breakpoints[addr >> 2] == 0)
+    {
+        return false;
+    }
+    breakpoints[addr >> 2] = 0;
+    --breakpointCount;
+    invalidate((int) addr);
+    return true;
+}
+
+void m20::Simulator::clearBreakpoints()
+{
+    for (size_t word = 0; word < breakpoints.size(); ++word)
+    {
+        if (breakpoints[word] != 0)
+        {
+            removeBreakpoint((unsigned int) word << 2);
+        }
+    }
+}
+
+bool m20::Simulator::atBreakpoint()
+{
+    auto pc = (unsigned int) regs.pc;
+    if (breakpointCount == 0 || (pc & 3) != 0 || pc > MAX_ADDRESS - 3
+        || breakpoints[pc >> 2] == 0 || instructionsExecuted == resumeCount)
+    {
+        return false;
+    }
+    breakpointHit = true;
+    stopAt = instructionsExecuted;
+    return true;
+}
+
+void m20::Simulator::observe(int addr, unsigned int size, Access access,
+                             int oldValue, int newValue)
+{
+    if (heatmapEnabled)
+    {
+        if (((uint8_t) access & (uint8_t) Access::READ) != 0)
+        {
+            heatmap.read((unsigned int) addr, size);
+        }
+        if (((uint8_t) access & (uint8_t) Access::WRITE) != 0)
+        {
+            heatmap.write((unsigned int) addr, size);
+        }
+    }
+    if (!watchpoints.empty() && isWatched(addr, size, access))
+    {
+        watch(addr, size, access, oldValue, newValue);
+    }
+}
+
+void m20::Simulator::watch(int addr, unsigned int size, Access access,
+                           int oldValue, int newValue)
+{
+    // Pages are only a filter; the access must overlap a watched range
+    auto begin = (unsigned int) addr;
+    bool hit = false;
+    for (const auto &w : watchpoints)
+    {
+        if (((uint8_t) w.access & (uint8_t) access) != 0
+            && begin < w.end && w.begin < begin + size)
+        {
+            hit = true;
+            break;
+        }
+    }
+
+    // Report the first hit of an instruction
+    if (!hit || watchTriggered)
+    {
+        return;
+    }
+    watchHit = {begin, size, access, (unsigned int) regs.pc - 4,
+                oldValue, newValue};
+    watchTriggered = true;
+    stopAt = std::min(stopAt, instructionsExecuted + 1);
+}
+
+void m20::Simulator::simulate()
+{
+    reset();
+    report(run(SIZE_MAX));
+}
+
+void m20::Simulator::report(Status status)
+{
+    if (status != Status::HALTED && status != Status::RUNNING
+        && status != Status::WATCHPOINT && status != Status::BREAKPOINT)
+    {
+        // Flush BIOS
+        bios.flush();
+
+        switch (status)
+        {
+            case Status::UNDEFINED_INSTRUCTION:
+                *out << ">>>>> Undefined Instruction @ 0x";
+                break;
+            case Status::PREFETCH_ABORT:
+                *out << ">>>>> Prefetch Abort @ 0x";
+                break;
+            case Status::DATA_ABORT:
+                *out << ">>>>> Data Abort @ 0x";
+                break;
+            case Status::USAGE_ABORT:
+                *out << ">>>>> Usage Abort @ 0x";
+                break;
+            case Status::IDLE:
+                *out << ">>>>> Idle Loop @ 0x";
+                break;
+            default:
+                *out << ">>>>> Undefined Interrupt Vector" << std::endl;
+                break;
+        }
+        if (status == Status::IDLE)
+        {
+            *out << std::hex << regs.pc << std::endl;     // The loop's head
+        }
+        else if (status != Status::UNDEFINED_INTERRUPT)
+        {
+            *out << std::hex << regs.pc - 4 << std::endl;
+        }
+    }
+
+    // Flush BIOS
+    bios.flush();
+
+    // Print halt information
+    printStatus();
+    *out << ">>>>> HALTED <<<<<" << std::endl;
+}
+
+bool m20::Simulator::readMemory(unsigned int addr, char *buffer,
+                                size_t size) const
+{
+    if (addr > MAX_ADDRESS || size > (size_t) MAX_ADDRESS + 1 - addr)
+    {
+        return false;
+    }
+    std::copy(mem + addr, mem + addr + size, buffer);
+    return true;
+}
+
+bool m20::Simulator::writeMemory(unsigned int addr, const char *buffer,
+                                 size_t size)
+{
+    if (addr > MAX_ADDRESS || size > (size_t) MAX_ADDRESS + 1 - addr)
+    {
+        return false;
+    }
+    std::copy(buffer, buffer + size, mem + addr);
+    for (size_t word = addr & ~3u; word < addr + size; word += 4)
+    {
+        written((int) word);
+    }
+    return true;
+}
+
+int m20::Simulator::divide(int a, int b)
+{
+    // INT_MIN / -1 overflows; wrap like the other arithmetic instructions
+    return b == -1 ? (int) (0u - (unsigned int) a) : a / b;
+}
+
+int m20::Simulator::divideUnsigned(int a, int b)
+{
+    auto divisor = (size_t) b & 0xFFF;
+    return (int) (((size_t) a & 0xFFFFFFFF) / divisor);
+}
+
+void m20::Simulator::restart()
+{
+    // Initialize simulator
+    regs = Registers();
+    regs.pc = 0;                     // Set to first instruction
+    regs.st = Simulator::MODE_SVR;   // Set to supervisor mode
+    *getRegister(13) = 0xfff8;      // Set stack ptr
+    *getRegister(13) -= (int) coreId * CORE_STACK_BYTES;  // One per core
+    *getRegister(14) = 0xfffc;      // Set link ptr to halt handler
+    storeWord(0xfffc, 0xE1F00000);  // Create halt handler
+    halt = false;
+    status = Status::RUNNING;
+    instructionsExecuted = 0;
+    instructionsSkipped = 0;
+    idle = false;
+    runTime = std::chrono::steady_clock::duration::zero();
+    histogram.clear();
+    watchTriggered = false;
+    heatmap.clear();
+    callGraph.clear();
+    interrupts = 0;
+    exclusive = false;
+    pending = Status::RUNNING;
+    faultAddress = 0;
+}
+
+m20::Status m20::Simulator::stop(Status status)
+{
+    halt = true;
+    this->status = status;
+    return status;
+}
+
+size_t m20::Simulator::roundToPage(size_t size)
+{
+    auto page = (size_t) sysconf(_SC_PAGESIZE);
+    return (size + page - 1) / page * page;
+}
+
+void m20::Simulator::analyze(size_t size)
+{
+    imageSize = size;
+    for (auto &d : decoded)
+    {
+        d.length = 0;
+    }
+    for (auto &page : codePages)
+    {
+        page &= (uint8_t) ~CODE_DECODED;
+    }
+    std::fill(tiers.begin(), tiers.end(), Engine::REFERENCE);
+    std::fill(heat.begin(), heat.end(), 0);
+    coldNext = -1;
+    std::fill(std::begin(tierInstructions), std::end(tierInstructions), 0);
+    promotions.clear();
+
+    // Discover code statically and predecode it ahead of execution, unless
+    // the tiered engine is to decide what is worth decoding
+    cfg.build(mem, size, 0);
+    if (engine != Engine::REFERENCE && engine != Engine::TIERED)
+    {
+        for (const auto &i : cfg.getBlocks())
+        {
+            for (unsigned int addr = i.second.begin; addr < i.second.end;
+                 addr += 4)
+            {
+                if (decoded[addr >> 2].length == 0)
+                {
+                    predecode(addr >> 2);
+                }
+            }
+        }
+    }
+}
+
+void m20::Simulator::printStatus()
+{
+    double seconds = std::chrono::duration<double>(runTime).count();
+    // Skipped idle iterations took no host time
+    size_t ran = instructionsExecuted - instructionsSkipped;
+    double mips = seconds > 0 ? ran / seconds / 1e6 : 0;
+    *out << "Executed " << std::dec << ran << " instructions" << std::endl;
+    if (instructionsSkipped != 0)
+    {
+        *out << "Skipped " << instructionsSkipped
+             << " instructions in idle loops" << std::endl;
+    }
+    *out << "Wall time " << std::fixed << std::setprecision(3) << seconds
+         << " s, " << std::setprecision(2) << mips << " MIPS"
+         << std::defaultfloat << std::setprecision(6) << std::endl;
+    *out << "Core Dump ----------------------\n";
+    *out << "R0 : " << std::setw(8) << std::setfill('0') << std::hex
+         << *getRegister(0) << "\n";
+    *out << "R1 : " << std::setw(8) << std::setfill('0') << std::hex
+         << *getRegister(1) << "\n";
+    *out << "R2 : " << std::setw(8) << std::setfill('0') << std::hex
+         << *getRegister(2) << "\n";
+    *out << "R3 : " << std::setw(8) << std::setfill('0') << std::hex
+         << *getRegister(3) << "\n";
+    *out << "R4 : " << std::setw(8) << std::setfill('0') << std::hex
+         << *getRegister(4) << "\n";
+    *out << "R5 : " << std::setw(8) << std::setfill('0') << std::hex
+         << *getRegister(5) << "\n";
+    *out << "R6 : " << std::setw(8) << std::setfill('0') << std::hex
+         << *getRegister(6) << "\n";
+    *out << "R7 : " << std::setw(8) << std::setfill('0') << std::hex
+         << *getRegister(7) << "\n";
+    *out << "R8 : " << std::setw(8) << std::setfill('0') << std::hex
+         << *getRegister(8) << "\n";
+    *out << "R9 : " << std::setw(8) << std::setfill('0') << std::hex
+         << *getRegister(9) << "\n";
+    *out << "R10: " << std::setw(8) << std::setfill('0') << std::hex
+         << *getRegister(10) << "\n";
+    *out << "R11: " << std::setw(8) << std::setfill('0') << std::hex
+         << *getRegister(11) << "\n";
+    *out << "R12: " << std::setw(8) << std::setfill('0') << std::hex
+         << *getRegister(12) << "\n";
+    *out << "SP : " << std::setw(8) << std::setfill('0') << std::hex
+         << *getRegister(13) << "\n";
+    *out << "LP : " << std::setw(8) << std::setfill('0') << std::hex
+         << *getRegister(14) << "\n";
+    *out << "PC : " << std::setw(8) << std::setfill('0') << std::hex
+         << *getRegister(15) << "\n";
+    *out << "ST : " << std::setw(8) << std::setfill('0') << std::hex
+         << *getStatus(0) << "\n";
+    *out << "--------------------------------" << std::dec << std::endl;
+}
+
+void m20::Simulator::printFusionReport()
+{
+    size_t ran = instructionsExecuted - instructionsSkipped;
+    size_t fused = 0;
+    *out << "Fusion Report ------------------\n";
+    for (unsigned int i = 1; i < FUSION_COUNT; ++i)
+    {
+        if (static_cast<Fusion>(i) == Fusion::BREAKPOINT)
+        {
+            continue;
+        }
+        size_t covered = static_cast<Fusion>(i) == Fusion::IDLE_LOOP
+                         ? idleInstructions
+                         : fusionHits[i]
+                           * Decoder::getLength(static_cast<Fusion>(i));
+        fused += covered;
+        *out << std::left << std::setw(18) << std::setfill(' ')
+             << FUSION_NAMES[i] << ": " << std::right << std::dec
+             << std::setw(10) << fusionHits[i] << " hits ("
+             << std::fixed << std::setprecision(1) << std::setw(5)
+             << (ran > 0 ? 100.0 * covered / ran : 0.0)
+             << "% of instructions)\n";
+    }
+    *out << std::left << std::setw(18) << "fused total" << ": "
+         << std::right << std::setw(10) << fused << " of "
+         << ran << " instructions\n";
+    *out << "--------------------------------" << std::endl;
+}
+
+void m20::Simulator::printTierReport()
+{
+    static const char *const TIER_NAMES[] = {
+            "reference",
+            "predecoded",
+            "translated"
+    };
+
+    // Cold words and translated blocks are counted as they run, so that the
+    // predecoded tier pays nothing for tiering and takes the rest, except
+    // for skipped idle iterations
+    size_t ran = instructionsExecuted - instructionsSkipped;
+    size_t counts[] = {
+            tierInstructions[(size_t) Engine::REFERENCE],
+            ran
+            - tierInstructions[(size_t) Engine::REFERENCE]
+            - tierInstructions[(size_t) Engine::TRANSLATED],
+            tierInstructions[(size_t) Engine::TRANSLATED]
+    };
+
+    *out << "Tier Report --------------------\n";
+    for (size_t i = 0; i < 3; ++i)
+    {
+        *out << std::left << std::setw(18) << std::setfill(' ')
+             << TIER_NAMES[i] << ": " << std::right << std::dec
+             << std::setw(10) << counts[i] << " instructions ("
+             << std::fixed << std::setprecision(1) << std::setw(5)
+             << (ran > 0 ? 100.0 * counts[i] / ran : 0.0)
+             << "%)\n";
+    }
+    *out << "Promotions (predecoded after " << predecodeThreshold
+         << " entries, translated after " << translateThreshold
+         << " more):\n";
+    for (const auto &promotion : promotions)
+    {
+        *out << "  0x" << std::hex << std::setw(8) << std::setfill('0')
+             << promotion.address << std::setfill(' ') << std::dec << " -> "
+             << std::left << std::setw(10)
+             << TIER_NAMES[static_cast<size_t>(promotion.tier)]
+             << std::right << " at instruction " << promotion.instruction
+             << "\n";
+    }
+    *out << "--------------------------------" << std::endl;
+}
+
+void m20::Simulator::step()
+{
+    if (!(regs.pc >= 0 && regs.pc < MAX_ADDRESS))
+    {
+        raise(Status::PREFETCH_ABORT, regs.pc);
+        return;
+    }
+
+    int instr = fetchWord(regs.pc);
+    if (histogramEnabled)
+    {
+        auto cond = ((unsigned int) instr >> 28) & 0xF;
+        histogram.record(instr, cond != 0xF && checkCondition((int) cond));
+    }
+    if (heatmapEnabled)
+    {
+        heatmap.execute((unsigned int) regs.pc, (unsigned int) regs.st & 0x3,
+                        (unsigned int) *getRegister(13));
+    }
+    if (callGraphEnabled)
+    {
+        callGraph.execute((unsigned int) regs.pc, instr);
+    }
+    regs.pc += 4;
+    execute(instr);
+    ++instructionsExecuted;
+}
+
+void m20::Simulator::stepPredecoded()
+{
+    if (codeWritten.load(std::memory_order_acquire))
+    {
+        takeCodeWrites();
+    }
+
+    // Unaligned and out of range fetches take the reference path
+    if ((regs.pc & 3) != 0
+        || !(regs.pc >= 0 && regs.pc <= (int) MAX_ADDRESS - 3))
+    {
+        step();
+        return;
+    }
+
+    size_t index = (size_t) regs.pc >> 2;
+    DecodedInstruction *d = &decoded[index];
+    if (d->length == 0)
+    {
+        // The tiered engine leaves cold words undecoded and runs them here
+        d = engine == Engine::TIERED ? warm(index) : &predecode(index);
+        if (d == nullptr)
+        {
+            return;
+        }
+    }
+    executePredecoded(d);
+}
+
+void m20::Simulator::executePredecoded(DecodedInstruction *d)
+{
+    if (d->fusion != Fusion::NONE)
+    {
+        executeFused(d);
+        return;
+    }
+
+    regs.pc += 4;
+    if (d->op == Op::GENERIC)
+    {
+        execute(d->raw);
+    }
+    else if (checkCondition(d->cond))
+    {
+        execute(*d);
+    }
+    ++instructionsExecuted;
+}
+
+void m20::Simulator::stepTranslated()
+{
+    if (codeWritten.load(std::memory_order_acquire))
+    {
+        takeCodeWrites();
+    }
+
+    if ((regs.pc & 3) == 0 && regs.pc >= 0 && regs.pc <= (int) MAX_ADDRESS - 3)
+    {
+        auto run = translated[(size_t) regs.pc >> 2];
+        if (run != nullptr)
+        {
+            size_t before = instructionsExecuted;
+            run(*this, regs);
+            tierInstructions[(size_t) Engine::TRANSLATED] +=
+                    instructionsExecuted - before;
+            return;
+        }
+    }
+
+    // Code discovered only at runtime runs on the predecoded engine
+    stepPredecoded();
+}
+
+m20::DecodedInstruction *m20::Simulator::warm(size_t index)
+{
+    if (tiers[index] == Engine::REFERENCE)
+    {
+        // Blocks are counted where control enters them, not per word
+        if (regs.pc != coldNext && ++heat[index] >= predecodeThreshold)
+        {
+            promote(index, Engine::PREDECODED);
+            return &predecode(index);
+        }
+        if (breakpointCount != 0 && atBreakpoint())
+        {
+            return nullptr;
+        }
+        size_t before = instructionsExecuted;
+        coldNext = regs.pc + 4;
+        step();
+        tierInstructions[(size_t) Engine::REFERENCE] += instructionsExecuted
+                                                        - before;
+        return nullptr;
+    }
+
+    if (dormant[index] != nullptr)
+    {
+        if (++heat[index] >= translateThreshold)
+        {
+            promote(index, Engine::TRANSLATED);
+            return nullptr;
+        }
+        executePredecoded(&predecode(index));
+        decoded[index].length = 0;      // To count the next entry as well
+        return nullptr;
+    }
+    return &predecode(index);
 }
 
-void m20::Simulator::simulate()
+void m20::Simulator::promote(size_t index, Engine tier)
 {
-    static const int DATA_SIGNATURE = 0x08000000;
-    static const int LOAD_SIGNATURE = 0x04000000;
-    static const int BRANCH_SIGNATURE = 0x02000000;
-    static const int COPROC_SIGNATURE = 0x01000000;
-
-    // Initialize simulator
-    reg_pc = 0;                     // Set to first instruction
-    reg_st = Simulator::MODE_SVR;   // Set to supervisor mode
-    for (int i = 0; i <= 12; ++i)   // Zero out registers
+    promotions.push_back({(unsigned int) index << 2, tier,
+                          instructionsExecuted});
+    heat[index] = 0;
+    if (tier == Engine::TRANSLATED)
     {
-        *getRegister(i) = 0;
+        tiers[index] = tier;
+        translated[index] = dormant[index];
+        dormant[index] = nullptr;
+        return;
     }
-    *getRegister(13) = 0xfff8;      // Set stack ptr
-    *getRegister(14) = 0xfffc;      // Set link ptr to halt handler
-    storeWord(0xfffc, 0xE1F00000);  // Create halt handler
-    halt = false;
 
-    // Initialize BIOS
-    for (unsigned int i = 0; i < Bios::WIDTH * Bios::HEIGHT; ++i)
+    // The block runs to the first instruction that may leave it; words
+    // already promoted belong to another block
+    for (size_t k = index; k < tiers.size() && tiers[k] == Engine::REFERENCE;
+         ++k)
     {
-        bios.write(0);
+        tiers[k] = tier;
+        if (Decoder::endsBlock(Decoder::decode(fetchWord((int) (k << 2)))))
+        {
+            break;
+        }
     }
-    bios.setCursor(0);
-    bios.flush();
+}
 
-    while (!halt)
+void m20::Simulator::executeIdleLoop(DecodedInstruction *d)
+{
+    size_t length = d->length;
+    for (int pass = 0; pass < 2; ++pass)
     {
-        try
+        // One iteration, with the bookkeeping of the reference loop
+        Registers before = regs;
+        for (size_t k = 0; k < length; ++k)
         {
-            if (!(reg_pc >= 0 && reg_pc < MAX_ADDRESS))
+            regs.pc += 4;
+            if (checkCondition(d[k].cond))
             {
-                throw PrefetchAbortException();
+                execute(d[k]);
             }
-
-            int instr = loadWord(reg_pc);
-            reg_pc += 4;
-            if (isCondition(instr))
+            ++instructionsExecuted;
+            if (halt || watchTriggered)
             {
-                if (!(DATA_SIGNATURE & instr))
-                {
-                    simulateData(instr);
-                }
-                else if (!(LOAD_SIGNATURE & instr))
-                {
-                    simulateLoad(instr);
-                }
-                else if (!(BRANCH_SIGNATURE & instr))
-                {
-                    simulateBranch(instr);
-                }
-                else if (!(COPROC_SIGNATURE & instr))
-                {
-                    throw UsageAbortException();
-                }
-                else // SWI
-                {
-                    simulateSwi(instr);
-                }
+                return;     // A load aborted or hit a watchpoint
             }
         }
-        catch (const UndefinedInstructionException &e)
+        idleInstructions += length;
+        if (regs.pc != before.pc)
         {
-            // Flush BIOS
-            bios.flush();
+            return;         // Left the loop
+        }
 
-            std::cout << ">>>>> Undefined Instruction @ 0x"
-                      << std::hex << reg_pc - 4 << std::endl;
-            halt = true;
-            break;
+        // The loop only writes registers, so an iteration that leaves them
+        // all as they were repeats until something outside the loop
+        // changes: a store by another core, seen at the earliest when run()
+        // returns to the multiprocessor. Whole iterations are skipped up to
+        // the end of the run, where the reference engine would be in the
+        // same state; a run without an end would spin forever. Skipped
+        // iterations still count for ic, but not as work the host did.
+        if (std::memcmp(&before, &regs, sizeof(Registers)) == 0)
+        {
+            if (stopAt == SIZE_MAX)
+            {
+                stop(Status::IDLE);
+            }
+            else if (stopAt > instructionsExecuted)
+            {
+                size_t skip = (stopAt - instructionsExecuted) / length
+                              * length;
+                instructionsExecuted += skip;
+                instructionsSkipped += skip;
+                idle = true;
+            }
+            return;
         }
-        catch (const PrefetchAbortException &e)
+        if (instructionsExecuted >= stopAt)
         {
-            // Flush BIOS
-            bios.flush();
+            return;
+        }
+    }
 
-            std::cout << ">>>>> Prefetch Abort @ 0x"
-                      << std::hex << reg_pc - 4 << std::endl;
-            halt = true;
-            break;
+    // Two iterations in a row made progress (the first may just load what
+    // the loop waits on), so this is a counting loop rather than a wait
+    d->fusion = Decoder::fuse(d, length, false);
+    d->length = Decoder::getLength(d->fusion);
+}
+
+m20::DecodedInstruction &m20::Simulator::predecode(size_t index)
+{
+    size_t available = 1;
+    if (fusion)
+    {
+        available = std::min((size_t) Decoder::MAX_FUSION,
+                             (MAX_ADDRESS + 1) / 4 - index);
+    }
+    for (size_t k = 1; breakpointCount != 0 && k < available; ++k)
+    {
+        if (breakpoints[index + k] != 0)
+        {
+            available = k;      // Sequences end before a breakpoint
         }
-        catch (const DataAbortException &e)
+    }
+
+    // Lookahead entries are decoded but left invalid (length 0) until they
+    // are executed themselves
+    for (size_t k = 0; k < available; ++k)
+    {
+        DecodedInstruction &e = decoded[index + k];
+        if (e.length == 0)
         {
-            // Flush BIOS
-            bios.flush();
+            e = Decoder::decode(fetchWord((int) ((index + k) << 2)));
+            e.length = 0;
+        }
+    }
 
-            std::cout << ">>>>> Data Abort @ 0x"
-                      << std::hex << reg_pc - 4 << std::endl;
-            halt = true;
-            break;
+    DecodedInstruction &head = decoded[index];
+    head.fusion = breakpoints[index] != 0
+                  ? Fusion::BREAKPOINT : Decoder::fuse(&head, available);
+    head.length = head.fusion == Fusion::IDLE_LOOP
+                  ? Decoder::getLoopLength(&head, available)
+                  : Decoder::getLength(head.fusion);
+
+    // A sequence can run onto the next page, which then holds code too
+    size_t last = index + head.length - 1;
+    markCode(index >> (PAGE_BITS - 2), CODE_DECODED);
+    markCode(last >> (PAGE_BITS - 2), CODE_DECODED);
+    return head;
+}
+
+void m20::Simulator::execute(int instr)
+{
+    static const int DATA_SIGNATURE = 0x08000000;
+    static const int LOAD_SIGNATURE = 0x04000000;
+    static const int BRANCH_SIGNATURE = 0x02000000;
+    static const int COPROC_SIGNATURE = 0x01000000;
+
+    if (isCondition(instr))
+    {
+        if (!(DATA_SIGNATURE & instr))
+        {
+            simulateData(instr);
         }
-        catch (const UsageAbortException &e)
+        else if (!(LOAD_SIGNATURE & instr))
         {
-            // Flush BIOS
-            bios.flush();
-
-            std::cout << ">>>>> Usage Abort @ 0x"
-                      << std::hex << reg_pc - 4 << std::endl;
-            halt = true;
-            break;
+            simulateLoad(instr);
+        }
+        else if (!(BRANCH_SIGNATURE & instr))
+        {
+            simulateBranch(instr);
+        }
+        else if (!(COPROC_SIGNATURE & instr))
+        {
+            raise(Status::USAGE_ABORT);
         }
-        catch (const SoftwareInterruptException &e)
+        else // SWI
         {
-            // Software Interrupt
-            if (e.vector == 0x00)
+            simulateSwi(instr);
+        }
+    }
+}
+
+void m20::Simulator::execute(const DecodedInstruction &d)
+{
+    HANDLERS[d.handler](*this, d);
+}
+
+void m20::Simulator::executeGeneric(const DecodedInstruction &d)
+{
+    switch (d.op)
+    {
+        case Op::PUSH:
+            push(d);
+            break;
+        case Op::POP:
+            pop(d.rm);
+            break;
+        case Op::B:
+        case Op::BWL:
+            if (d.op == Op::BWL)
             {
-                reg_pc = e.index;
+                *getRegister(14) = regs.pc;
             }
+            regs.pc = d.immediate ? regs.pc + d.imm : *getRegister(d.rm);
+            return;
+        case Op::SWI:
+            serviceSwi(d.imm);
+            return;
+        default:
+            execute(d.raw);
+            return;
+    }
+
+    // A push or pop that aborted leaves st as it was, as on the reference
+    if (d.update && !halt)
+    {
+        updateStatus(0, 0, 0);
+    }
+}
 
-            // BIOS Interrupt
-            else if (e.vector == 0x10)
+void m20::Simulator::executeFused(DecodedInstruction *d)
+{
+    ++fusionHits[static_cast<size_t>(d->fusion)];
+
+    // Components run in order with the same PC and instruction count
+    // bookkeeping as the reference loop, so that an abort part way through
+    // leaves identical state. Only the final component may branch, and a
+    // store that patches the sequence itself or an access that hits a
+    // watchpoint ends it early.
+    switch (d->fusion)
+    {
+        case Fusion::COMPARE_BRANCH:
+            regs.pc += 4;
+            execute(d[0]);
+            ++instructionsExecuted;
+            regs.pc += 4;
+            if (checkCondition(d[1].cond))
             {
-                if (*getRegister(0) == 0x0a)
-                {
-                    bios.write((char) (*getRegister(1) & 0xFF));
-                }
+                regs.pc += d[1].imm;
             }
-
-            // Invalid SWI
-            else
+            ++instructionsExecuted;
+            break;
+        case Fusion::PUSH_PAIR:
+            regs.pc += 4;
+            push(d[0]);
+            ++instructionsExecuted;
+            if (d->length == 0 || halt || watchTriggered)
             {
-                throw UsageAbortException();
+                break;
             }
-        }
-        catch (...)
+            regs.pc += 4;
+            push(d[1]);
+            ++instructionsExecuted;
+            break;
+        case Fusion::POP_POP_RETURN:
+            regs.pc += 4;
+            pop(d[0].rm);
+            ++instructionsExecuted;
+            if (halt || watchTriggered)
+            {
+                break;
+            }
+            // Fall through
+        case Fusion::POP_RETURN:
+            regs.pc += 4;
+            pop(14);
+            ++instructionsExecuted;
+            if (halt || watchTriggered)
+            {
+                break;
+            }
+            regs.pc += 4;
+            regs.pc = *getRegister(14);
+            ++instructionsExecuted;
+            break;
+        case Fusion::COPY_LOOP:
+            regs.pc += 4;
+            execute(d[0]);
+            ++instructionsExecuted;
+            regs.pc += 4;
+            *getRegister(d[1].rd) = (int) ((unsigned int) loadByte(
+                    *getRegister(d[1].rn) + *getRegister(d[1].rm)));
+            ++instructionsExecuted;
+            if (watchTriggered)
+            {
+                break;
+            }
+            regs.pc += 4;
+            storeByte(*getRegister(d[2].rn) + *getRegister(d[2].rm),
+                      *getRegister(d[2].rd));
+            ++instructionsExecuted;
+            if (d->length == 0 || watchTriggered)
+            {
+                break;
+            }
+            regs.pc += 4;
+            if (checkCondition(d[3].cond))
+            {
+                regs.pc += d[3].imm;
+            }
+            ++instructionsExecuted;
+            break;
+        case Fusion::FILL_LOOP:
+            regs.pc += 4;
+            execute(d[0]);
+            ++instructionsExecuted;
+            regs.pc += 4;
+            storeByte(*getRegister(d[1].rn) + *getRegister(d[1].rm),
+                      *getRegister(d[1].rd));
+            ++instructionsExecuted;
+            if (d->length == 0 || watchTriggered)
+            {
+                break;
+            }
+            regs.pc += 4;
+            if (checkCondition(d[2].cond))
+            {
+                regs.pc += d[2].imm;
+            }
+            ++instructionsExecuted;
+            break;
+        case Fusion::IDLE_LOOP:
+            executeIdleLoop(d);
+            break;
+        case Fusion::BREAKPOINT:
+            // Stops run() before the word, unless the run resumes from it
+            if (!atBreakpoint())
+            {
+                step();
+            }
+            break;
+        default:
+            assert(false);
+            break;
+    }
+}
+
+void m20::Simulator::serviceSwi(int vector)
+{
+    // Like any exception entry, an interrupt breaks an ldrex/strex pair
+    exclusive = false;
+
+    // Software Interrupt
+    if (vector == 0x00)
+    {
+        regs.pc = SoftwareInterruptException::INDEX;
+    }
+
+    // BIOS Interrupt
+    else if (vector == 0x10)
+    {
+        if (*getRegister(0) == 0x0a)
         {
-            // Flush BIOS
-            bios.flush();
+            // All cores write to the screen of core 0
+            std::lock_guard<std::mutex> lock(primary->biosLock);
+            primary->bios.write((char) (*getRegister(1) & 0xFF));
+        }
+    }
 
-            std::cout << ">>>>> Undefined Interrupt Vector" << std::endl;
-            halt = true;
-            break;
+    // Inter-processor Interrupt
+    else if (vector == 0x20)
+    {
+        sendInterrupt((unsigned int) *getRegister(0));
+    }
+
+    // Invalid SWI
+    else
+    {
+        raise(Status::USAGE_ABORT);
+    }
+}
+
+void m20::Simulator::sendInterrupt(unsigned int target)
+{
+    const std::vector<Simulator *> &all = primary->cores;
+    if (target >= all.size() || all[target] == nullptr)
+    {
+        raise(Status::USAGE_ABORT);
+        return;
+    }
+    all[target]->interrupts.fetch_or(1u << coreId);
+}
+
+void m20::Simulator::shareWrite(int addr)
+{
+    // The other cores drop their entries for the word before their next
+    // step. This is ordered before any later store of this core, so a core
+    // that acquires a flag stored after the patch runs the patched code.
+    uint32_t others = __atomic_load_n(
+            &sharedCode[(unsigned int) addr >> PAGE_BITS], __ATOMIC_ACQUIRE)
+                      & ~(1u << coreId);
+    const std::vector<Simulator *> &all = primary->cores;
+    for (unsigned int id = 0; id < all.size(); ++id)
+    {
+        if ((others & (1u << id)) != 0 && all[id] != nullptr)
+        {
+            std::lock_guard<std::mutex> lock(all[id]->codeWriteLock);
+            all[id]->codeWrites.push_back(addr);
+            all[id]->codeWritten.store(true, std::memory_order_release);
         }
+    }
+}
 
-        ++instructionsExecuted;
+void m20::Simulator::takeCodeWrites()
+{
+    std::vector<int> writes;
+    {
+        std::lock_guard<std::mutex> lock(codeWriteLock);
+        writes.swap(codeWrites);
+        codeWritten.store(false, std::memory_order_relaxed);
+    }
+    for (int addr : writes)
+    {
+        invalidate(addr);
     }
+}
 
-    // Flush BIOS
-    bios.flush();
+uint32_t *m20::Simulator::atomicWord(int addr)
+{
+    if (!(addr >= 0 && addr <= MAX_ADDRESS - 3) || (addr & 3) != 0)
+    {
+        dataAbort(addr);
+    }
+    return reinterpret_cast<uint32_t *>(mem + addr);
+}
 
-    // Print halt information
-    printStatus();
-    std::cout << ">>>>> HALTED <<<<<" << std::endl;
+int m20::Simulator::swapWord(int addr, int val)
+{
+    uint32_t *word = atomicWord(addr);
+    auto old = (int) fromBigEndian(__atomic_exchange_n(
+            word, fromBigEndian((uint32_t) val), __ATOMIC_ACQ_REL));
+    written(addr);
+    if (observed)
+    {
+        observe(addr, 4, Access::READ_WRITE, old, val);
+    }
+    return old;
 }
 
-void m20::Simulator::printStatus()
+int m20::Simulator::loadExclusive(int addr)
+{
+    uint32_t *word = atomicWord(addr);
+    exclusive = true;
+    exclusiveAddress = addr;
+    exclusiveValue = __atomic_load_n(word, __ATOMIC_ACQUIRE);
+
+    auto value = (int) fromBigEndian(exclusiveValue);
+    if (observed)
+    {
+        observe(addr, 4, Access::READ, value, value);
+    }
+    return value;
+}
+
+bool m20::Simulator::storeExclusive(int addr, int val)
+{
+    uint32_t *word = atomicWord(addr);
+    bool linked = exclusive && exclusiveAddress == addr;
+    exclusive = false;
+
+    // The reservation is the value ldrex read: the store succeeds if the
+    // word still holds it, which is one host compare-and-swap
+    uint32_t expected = exclusiveValue;
+    if (!linked || !__atomic_compare_exchange_n(
+            word, &expected, fromBigEndian((uint32_t) val), false,
+            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        return false;
+    }
+    written(addr);
+    if (observed)
+    {
+        observe(addr, 4, Access::WRITE, (int) fromBigEndian(expected), val);
+    }
+    return true;
+}
+
+void m20::Simulator::updateStatus(long long aluReg, int aluA, int aluB)
 {
-    std::cout << "Executed " << std::dec << instructionsExecuted
-              << " instructions" << std::endl;
-    std::cout << "Core Dump ----------------------\n";
-    std::cout << "R0 : " << std::setw(8) << std::setfill('0') << std::hex
-              << *getRegister(0) << "\n";
-    std::cout << "R1 : " << std::setw(8) << std::setfill('0') << std::hex
-              << *getRegister(1) << "\n";
-    std::cout << "R2 : " << std::setw(8) << std::setfill('0') << std::hex
-              << *getRegister(2) << "\n";
-    std::cout << "R3 : " << std::setw(8) << std::setfill('0') << std::hex
-              << *getRegister(3) << "\n";
-    std::cout << "R4 : " << std::setw(8) << std::setfill('0') << std::hex
-              << *getRegister(4) << "\n";
-    std::cout << "R5 : " << std::setw(8) << std::setfill('0') << std::hex
-              << *getRegister(5) << "\n";
-    std::cout << "R6 : " << std::setw(8) << std::setfill('0') << std::hex
-              << *getRegister(6) << "\n";
-    std::cout << "R7 : " << std::setw(8) << std::setfill('0') << std::hex
-              << *getRegister(7) << "\n";
-    std::cout << "R8 : " << std::setw(8) << std::setfill('0') << std::hex
-              << *getRegister(8) << "\n";
-    std::cout << "R9 : " << std::setw(8) << std::setfill('0') << std::hex
-              << *getRegister(9) << "\n";
-    std::cout << "R10: " << std::setw(8) << std::setfill('0') << std::hex
-              << *getRegister(10) << "\n";
-    std::cout << "R11: " << std::setw(8) << std::setfill('0') << std::hex
-              << *getRegister(11) << "\n";
-    std::cout << "R12: " << std::setw(8) << std::setfill('0') << std::hex
-              << *getRegister(12) << "\n";
-    std::cout << "SP : " << std::setw(8) << std::setfill('0') << std::hex
-              << *getRegister(13) << "\n";
-    std::cout << "LP : " << std::setw(8) << std::setfill('0') << std::hex
-              << *getRegister(14) << "\n";
-    std::cout << "PC : " << std::setw(8) << std::setfill('0') << std::hex
-              << *getRegister(15) << "\n";
-    std::cout << "ST : " << std::setw(8) << std::setfill('0') << std::hex
-              << *getStatus(0) << "\n";
-    std::cout << "--------------------------------" << std::dec << std::endl;
+    *getStatus(0) = nextStatus(*getStatus(0), aluReg, aluA, aluB);
 }
 
 bool m20::Simulator::isCondition(int instr)
 {
-    switch ((instr & 0xF0000000) >> 28)
-    {
-        case 0x0:   // EQ
-            return (reg_st & ST_Z) != 0;
-        case 0x1:   // NE
-            return (reg_st & ST_Z) == 0;
-        case 0x2:   // CS
-            return (reg_st & ST_C) != 0;
-        case 0x3:   // CC
-            return (reg_st & ST_C) == 0;
-        case 0x4:   // MI
-            return (reg_st & ST_N) != 0;
-        case 0x5:   // PL
-            return (reg_st & ST_N) == 0;
-        case 0x6:   // VS
-            return (reg_st & ST_V) != 0;
-        case 0x7:   // VC
-            return (reg_st & ST_V) == 0;
-        case 0x8:   // HI
-            return (reg_st & ST_C) != 0 && (reg_st & ST_Z) == 0;
-        case 0x9:   // LS
-            return (reg_st & ST_C) == 0 || (reg_st & ST_Z) != 0;
-        case 0xA:   // GE
-            return ((reg_st & ST_N) >> 3) == (reg_st & ST_V);
-        case 0xB:   // LT
-            return ((reg_st & ST_N) >> 3) != (reg_st & ST_V);
-        case 0xC:   // GT
-            return (reg_st & ST_Z) == 0
-                   && ((reg_st & ST_N) >> 3) == (reg_st & ST_V);
-        case 0xD:   // LE
-            return (reg_st & ST_Z) != 0
-                   || ((reg_st & ST_N) >> 3) != (reg_st & ST_V);
-        case 0xE:   // AL
+    return checkCondition((instr & 0xF0000000) >> 28);
+}
+
+bool m20::Simulator::checkCondition(int cond)
+{
+    if ((cond & 0xF) == 0xF)    // INVALID
+    {
+        raise(Status::UNDEFINED_INSTRUCTION);
+        return false;
+    }
+    return testCondition(regs.st, cond);
+}
+
+bool m20::Simulator::readStatus(int reg, int &val)
+{
+    switch (reg)
+    {
+        case 0:     // ST
+            val = regs.st;
+            return true;
+        case 1:     // SV
+            if (getMode() == 0)
+            {
+                break;
+            }
+            val = regs.sv[getMode()];
+            return true;
+        case 2:     // IC (instructions retired, low word)
+            val = (int) (instructionsExecuted & 0xFFFFFFFF);
+            return true;
+        case 3:     // ICH (instructions retired, high word)
+            val = (int) (((unsigned long long) instructionsExecuted >> 32)
+                         & 0xFFFFFFFF);
+            return true;
+        case 4:     // CID (core ID)
+            val = (int) coreId;
+            return true;
+        case 5:     // IPI (pending inter-processor interrupts, read clears)
+            if (getMode() == 0)
+            {
+                break;
+            }
+            val = (int) interrupts.exchange(0);
+            return true;
+        case 6:     // FAR (address of the last data abort)
+            if (getMode() == 0)
+            {
+                break;
+            }
+            val = faultAddress;
+            return true;
+        default:
+            break;
+    }
+    raise(Status::USAGE_ABORT);
+    return false;
+}
+
+bool m20::Simulator::writeStatus(int reg, int val)
+{
+    if (getMode() == 0)
+    {
+        raise(Status::USAGE_ABORT);
+        return false;
+    }
+    switch (reg)
+    {
+        case 0:     // ST
+            regs.st = val;
             return true;
-        default:    // INVALID
-            throw UndefinedInstructionException();
+        case 1:     // SV
+            regs.sv[getMode()] = val;
+            return true;
+        default:    // The rest are read-only
+            raise(Status::USAGE_ABORT);
             return false;
     }
 }
@@ -300,8 +1659,8 @@ void m20::Simulator::simulateData(int instr)
     switch (opcode)
     {
         case 0x00:  // NOOP
-            throw UndefinedInstructionException();
-            break;
+            raise(Status::UNDEFINED_INSTRUCTION);
+            return;
         case 0x01:  // ADD
             aluA = *getRegister(rn);
             aluB = (hasImmediate ? immediate12 : *getRegister(immediate12));
@@ -311,7 +1670,7 @@ void m20::Simulator::simulateData(int instr)
         case 0x02:  // ADC
             aluA = *getRegister(rn);
             aluB = (hasImmediate ? immediate12 : *getRegister(immediate12));
-            aluReg = aluA + aluB + ((reg_st & ST_C) != 0 ? 1 : 0);
+            aluReg = aluA + aluB + ((regs.st & ST_C) != 0 ? 1 : 0);
             *getRegister(rd) = (int) aluReg;
             break;
         case 0x03:  // SUB
@@ -323,7 +1682,7 @@ void m20::Simulator::simulateData(int instr)
         case 0x04:  // SBC
             aluA = *getRegister(rn);
             aluB = (hasImmediate ? immediate12 : *getRegister(immediate12));
-            aluReg = aluA - aluB - ((reg_st & ST_C) == 0 ? 1 : 0);
+            aluReg = aluA - aluB - ((regs.st & ST_C) == 0 ? 1 : 0);
             *getRegister(rd) = (int) aluReg;
             break;
         case 0x05:  // MUL
@@ -335,14 +1694,21 @@ void m20::Simulator::simulateData(int instr)
         case 0x06:  // DIV
             aluA = *getRegister(rn);
             aluB = (hasImmediate ? immediate12 : *getRegister(immediate12));
-            aluReg = aluA / aluB;
+            if (!isDivisor(aluB, false))
+            {
+                return;
+            }
+            aluReg = divide(aluA, aluB);
             *getRegister(rd) = (int) aluReg;
             break;
         case 0x07:  // UDV
             aluA = *getRegister(rn);
             aluB = (hasImmediate ? immediate12 : *getRegister(immediate12));
-            aluReg = (int) (((size_t) aluA & 0xFFFFFFFF)
-                            / ((size_t) aluB & 0xFFF));
+            if (!isDivisor(aluB, true))
+            {
+                return;
+            }
+            aluReg = divideUnsigned(aluA, aluB);
             *getRegister(rd) = (int) aluReg;
             break;
         case 0x08:  // OR
@@ -388,11 +1754,11 @@ void m20::Simulator::simulateData(int instr)
             *getRegister(rd) = (int) aluReg;
             break;
         case 0x0F:  // LSR
-            throw UsageAbortException();
-            break;
+            raise(Status::USAGE_ABORT);
+            return;
         case 0x10:  // ASR
-            throw UsageAbortException();
-            break;
+            raise(Status::USAGE_ABORT);
+            return;
         case 0x11:  // MOV
             aluA = (hasImmediate ? immediate16 : *getRegister(immediate16));
             aluB = 0;
@@ -430,6 +1796,10 @@ void m20::Simulator::simulateData(int instr)
             shouldUpdate = true;
             break;
         case 0x17:  // PUSH
+            if (!isMapped(*getRegister(13) - 4, 4))
+            {
+                return;     // Restartable: sp is left as it was
+            }
             *getRegister(13) -= 4;
             if (hasImmediate)
             {
@@ -443,48 +1813,54 @@ void m20::Simulator::simulateData(int instr)
         case 0x18:  // POP
             if (hasImmediate)
             {
-                throw UndefinedInstructionException();
+                raise(Status::UNDEFINED_INSTRUCTION);
+                return;
             }
-            else
+            else if (!isMapped(*getRegister(13), 4))
             {
-                *getRegister(immediate20) = loadWord(*getRegister(13));
+                return;
             }
+            *getRegister(immediate20) = loadWord(*getRegister(13));
             *getRegister(13) += 4;
             break;
         case 0x19:  // SRL
-            throw UsageAbortException();
+            if (hasImmediate)
+            {
+                raise(Status::UNDEFINED_INSTRUCTION);
+                return;
+            }
+            {
+                int val = 0;
+                if (!readStatus(immediate16, val))
+                {
+                    return;
+                }
+                *getRegister(rd) = val;
+            }
             break;
         case 0x1A:  // SRS
-            throw UsageAbortException();
+            if (!writeStatus(rd, hasImmediate ? immediate16
+                                              : *getRegister(immediate16)))
+            {
+                return;
+            }
             break;
         case 0x1F:
             if (getMode() == 0)
             {
-                throw UsageAbortException();
+                raise(Status::USAGE_ABORT);
+                return;
             }
             halt = true;
             break;
         default:
-            throw UndefinedInstructionException();
+            raise(Status::UNDEFINED_INSTRUCTION);
+            return;
     }
 
     if (shouldUpdate)
     {
-        static const long long MASK = 0xFFFFFFFF;
-        static const long long NEGATIVE = 0x0000000080000000;
-        static const long long CARRY = 0xFFFFFFFF00000000;
-        static const int OVERFLOW = 0x80000000;
-
-        int status = 0;
-        status |= (aluReg & NEGATIVE) == NEGATIVE ? 0x80000000 : 0x0;
-        status |= (aluReg & MASK) == 0 ? 0x40000000 : 0x0;
-        status |= (aluReg & CARRY) != 0 ? 0x20000000 : 0x0;
-        bool carryIn = (aluA & OVERFLOW) == OVERFLOW
-                       && (aluB & OVERFLOW) == OVERFLOW;
-        bool carryOut = (aluReg & NEGATIVE) == NEGATIVE;
-        status |= carryIn ^ carryOut;
-        *getStatus(0) &= 0x0FFFFFFF;
-        *getStatus(0) |= status;
+        updateStatus(aluReg, aluA, aluB);
     }
 }
 
@@ -492,7 +1868,7 @@ void m20::Simulator::simulateLoad(int instr)
 {
     static const int IMMEDIATE = 0x02000000;
     static const int BASE = 0x01000000;
-    static const int OPCODE = 0x00700000;
+    static const int OPCODE = 0x00F00000;
     static const int RD = 0x000F0000;
     static const int RN = 0x0000F000;
     static const int IMMEDIATE_16 = 0x0000FFFF;
@@ -502,7 +1878,7 @@ void m20::Simulator::simulateLoad(int instr)
 
     bool hasImmediate = (instr & IMMEDIATE) != 0;
     bool hasBase = (instr & BASE) != 0;
-    int opcode = (instr & OPCODE) >> 20 & 0x7;
+    int opcode = (instr & OPCODE) >> 20 & 0xF;
     int rd = ((instr & RD) >> 16) & 0xF;
     int rn = ((instr & RN) >> 12) & 0xF;
     int immediate16 = instr & IMMEDIATE_16;
@@ -539,6 +1915,18 @@ void m20::Simulator::simulateLoad(int instr)
         base = *getRegister(15);
     }
 
+    // Check the access up front, so that an abort needs no unwinding
+    static const unsigned int SIZES[] = {4, 1, 2, 1, 2, 4, 1, 2, 4, 4, 4};
+    if (opcode > 0xA)
+    {
+        raise(Status::UNDEFINED_INSTRUCTION);
+        return;
+    }
+    if (!isMapped(base + offset, SIZES[opcode]))
+    {
+        return;
+    }
+
     switch (opcode)
     {
         case 0x0:   // LDR
@@ -566,8 +1954,18 @@ void m20::Simulator::simulateLoad(int instr)
         case 0x7:   // STRH
             storeHalfword(base + offset, *getRegister(rd));
             break;
+        case 0x8:   // SWP
+            *getRegister(rd) = swapWord(base + offset, *getRegister(rd));
+            break;
+        case 0x9:   // LDREX
+            *getRegister(rd) = loadExclusive(base + offset);
+            break;
+        case 0xA:   // STREX
+            *getRegister(rd) = storeExclusive(base + offset,
+                                              *getRegister(rd)) ? 0 : 1;
+            break;
         default:
-            throw UndefinedInstructionException();
+            break;
     }
 }
 
@@ -605,6 +2003,5 @@ void m20::Simulator::simulateBranch(int instr)
 
 void m20::Simulator::simulateSwi(int instr)
 {
-    int vector = instr & 0x00FFFFFF;
-    throw SoftwareInterruptException(vector);
+    serviceSwi(instr & 0x00FFFFFF);
 }
@@ -11,9 +11,23 @@
 #ifndef M20_ASSEMBLY_SIMULATOR_H
 #define M20_ASSEMBLY_SIMULATOR_H
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "CallGraph.h"
+#include "ControlFlowGraph.h"
+#include "Decoder.h"
+#include "Heatmap.h"
+#include "Histogram.h"
 
 namespace m20
 {
@@ -31,8 +45,10 @@ namespace m20
 
     struct UndefinedInstructionException : public ProcessorException
     {
+        static const int INDEX = 0x4;
+
         UndefinedInstructionException()
-                : ProcessorException("Undefined Instruction", 0x4)
+                : ProcessorException("Undefined Instruction", INDEX)
         {
             //
         }
@@ -40,10 +56,12 @@ namespace m20
 
     struct SoftwareInterruptException : public ProcessorException
     {
+        static const int INDEX = 0x8;
+
         const int vector;
 
         SoftwareInterruptException(int vector)
-                : ProcessorException("Software Interrupt", 0x8),
+                : ProcessorException("Software Interrupt", INDEX),
                   vector(vector)
         {
             //
@@ -52,8 +70,10 @@ namespace m20
 
     struct PrefetchAbortException : public ProcessorException
     {
+        static const int INDEX = 0xc;
+
         PrefetchAbortException()
-                : ProcessorException("Prefetch Abort", 0xc)
+                : ProcessorException("Prefetch Abort", INDEX)
         {
             //
         }
@@ -61,8 +81,10 @@ namespace m20
 
     struct DataAbortException : public ProcessorException
     {
+        static const int INDEX = 0x10;
+
         DataAbortException()
-                : ProcessorException("Data Abort", 0x10)
+                : ProcessorException("Data Abort", INDEX)
         {
             //
         }
@@ -70,8 +92,10 @@ namespace m20
 
     struct UsageAbortException : public ProcessorException
     {
+        static const int INDEX = 0x14;
+
         UsageAbortException()
-                : ProcessorException("Usage Abort", 0x14)
+                : ProcessorException("Usage Abort", INDEX)
         {
             //
         }
@@ -94,6 +118,11 @@ namespace m20
 
         static const std::string CSI;
 
+        void setOutput(std::ostream &out)
+        {
+            this->out = &out;
+        }
+
         void setCursor(unsigned int cursor)
         {
             this->cursor = cursor;
@@ -112,9 +141,9 @@ namespace m20
             else
             {
                 mem[cursor] = byte;
-                std::cout << CSI << cursor / WIDTH + 1
-                          << ";" << cursor % WIDTH + 1 << "H"
-                          << byte;
+                *out << CSI << cursor / WIDTH + 1
+                     << ";" << cursor % WIDTH + 1 << "H"
+                     << byte;
                 ++cursor;
             }
         }
@@ -128,108 +157,627 @@ namespace m20
                     char c = mem[WIDTH * y + x];
                     if (c != 0)
                     {
-                        std::cout << c;
+                        *out << c;
                     }
                 }
-                std::cout << "\n";
+                *out << "\n";
             }
-            std::cout << std::flush;
+            *out << std::flush;
         }
 
     private:
-        unsigned int cursor;
+        std::ostream *out = &std::cout;
+        unsigned int cursor = 0;
         char mem[WIDTH * HEIGHT];
     };
 
+    /**
+     * Execution engines of the simulator
+     */
+    enum class Engine
+    {
+        REFERENCE,      // Fetch and decode every instruction word
+        PREDECODED,     // Execute cached decodings, fusing common sequences
+        TRANSLATED,     // Run ahead-of-time translated blocks (see aot)
+        TIERED          // Start on the reference engine, promote hot blocks
+    };
+
+    /**
+     * Result of running the simulator
+     */
+    enum class Status
+    {
+        RUNNING,                // Stopped after the requested instructions
+        HALTED,
+        UNDEFINED_INSTRUCTION,
+        PREFETCH_ABORT,
+        DATA_ABORT,
+        USAGE_ABORT,
+        UNDEFINED_INTERRUPT,
+        WATCHPOINT,             // Stopped after an access hit a watchpoint
+        BREAKPOINT,             // Stopped before a breakpoint instruction
+        IDLE                    // Stopped in a loop that cannot exit
+    };
+
+    /**
+     * Returns a lower case description of status ("usage abort")
+     */
+    const char *getStatusName(Status status);
+
+    /**
+     * Guest memory accesses a watchpoint traps on
+     */
+    enum class Access : uint8_t
+    {
+        READ = 1,
+        WRITE = 2,
+        READ_WRITE = 3
+    };
+
+    /**
+     * Access that hit a watchpoint. For reads the old and new values are
+     *  both the value read.
+     */
+    struct WatchHit
+    {
+        unsigned int address;
+        unsigned int size;
+        Access access;          // READ or WRITE
+        unsigned int pc;        // Address of the accessing instruction
+        int oldValue;
+        int newValue;
+    };
+
+    /**
+     * Architectural register file. SP, LP and SV are banked per mode.
+     */
+    struct Registers
+    {
+        int r[13];
+        int sp[4];
+        int lp[4];
+        int pc;
+        int st;
+        int sv[4];
+    };
+
+    /**
+     * Everything besides memory that decides how a simulator continues,
+     *  as saved by Simulator::saveState
+     */
+    struct ProcessorState
+    {
+        Registers regs;
+        size_t instructionsExecuted;
+        size_t instructionsSkipped;
+        bool halt;
+        Status status;
+        bool exclusive;
+        int exclusiveAddress;
+        uint32_t exclusiveValue;
+        int faultAddress;
+        uint32_t interrupts;
+        Bios bios;
+    };
+
+    class Simulator;
+
+    /**
+     * Natively compiled basic block covering [begin, end). Translated code
+     *  keeps PC and the instruction count exact at every instruction and
+     *  returns to the simulator after each block.
+     */
+    struct TranslatedBlock
+    {
+        unsigned int begin;
+        unsigned int end;
+        void (*run)(Simulator &sim, Registers &r);
+    };
+
     class Simulator
     {
     public:
-        Simulator(size_t memorySize)
-                : MAX_ADDRESS(memorySize - 1),
-                  mem(new char[memorySize]),
-                  instructionsExecuted(0)
+        static const unsigned int PAGE_BITS = 8;
+        static const unsigned int PAGE_BYTES = 1 << PAGE_BITS;
+        static const unsigned int MAX_CORES = 32;
+        static const int CORE_STACK_BYTES = 0x400;  // Initial SP spacing
+        static const uint32_t PREDECODE_THRESHOLD = 16;  // Tiered defaults,
+        static const uint32_t TRANSLATE_THRESHOLD = 64;  // in block entries
+
+        /**
+         * Creates a simulator with zeroed guest memory. Memory is reserved
+         *  with mmap, so untouched pages cost nothing.
+         * @param memorySize Size of guest memory in bytes
+         */
+        explicit Simulator(size_t memorySize);
+
+        /**
+         * Creates core coreId of a multiprocessor. The core shares guest
+         *  memory and the BIOS screen with primary (core 0) but has its own
+         *  registers, banked state and decode caches. primary must outlive
+         *  the core.
+         */
+        Simulator(Simulator &primary, unsigned int coreId);
+
+        ~Simulator();
+
+        Simulator(const Simulator &) = delete;
+        Simulator &operator=(const Simulator &) = delete;
+
+        /**
+         * Copies an executable file into memory at address 0. Memory is
+         *  a fresh anonymous mapping, so pages past the image cost nothing
+         *  until touched, and the run does not depend on the file afterwards.
+         * @param fname Executable image (.mc)
+         * @return False if the file cannot be read or does not fit in memory
+         */
+        bool load(const std::string &fname);
+
+        /**
+         * Copies an executable image into memory at address 0
+         * @param image Executable image
+         * @param size Size of image in bytes
+         * @return False if the image does not fit in memory
+         */
+        bool load(const char *image, size_t size);
+
+        /**
+         * Prepares a secondary core for the image its primary core loaded
+         */
+        void attach();
+
+        /**
+         * Returns the control-flow graph discovered when loading
+         */
+        const ControlFlowGraph &getControlFlowGraph() const
         {
-            //
+            return cfg;
         }
 
-        ~Simulator()
+        /**
+         * Sends BIOS output and reports to out instead of std::cout
+         */
+        void setOutput(std::ostream &out)
         {
-            delete[] mem;
+            this->out = &out;
+            bios.setOutput(out);
         }
 
-        void load(const std::string &fname);
+        /**
+         * Resets registers and the BIOS screen (on core 0) for a new run.
+         *  Memory keeps the loaded image.
+         */
+        void reset();
+
+        /**
+         * Records the current memory contents as the state restore() rolls
+         *  back to
+         */
+        void checkpoint();
+
+        /**
+         * Copies back only the pages written since checkpoint() and resets
+         *  registers. The BIOS screen is not cleared. Intended for running
+         *  many short programs (fuzzing) on one simulator.
+         */
+        void restore();
+
+        /**
+         * Copies the processor state (registers, instruction count, halt
+         *  and abort status, ldrex reservation, BIOS screen)
+         */
+        void saveState(ProcessorState &state) const;
+
+        /**
+         * Replaces the processor state with one saved by saveState. Memory
+         *  is not touched.
+         */
+        void loadState(const ProcessorState &state);
+
+        /**
+         * Runs until the processor halts, aborts, or at least steps more
+         *  instructions have executed. The predecoded and translated engines
+         *  stop at the end of the fused sequence or block that crosses the
+         *  limit.
+         * @param steps Maximum number of instructions to execute
+         * @return HALTED or the abort that stopped the processor, RUNNING
+         *  if the limit was reached first, or the watchpoint or breakpoint
+         *  that interrupted the run
+         */
+        Status run(size_t steps);
 
+        /**
+         * Resets and runs until halted, then prints the BIOS screen and
+         *  a core dump
+         */
         void simulate();
 
+        /**
+         * Prints the abort that stopped the processor (if any), the BIOS
+         *  screen and a core dump
+         * @param status Result of run()
+         */
+        void report(Status status);
+
         void printStatus();
 
-    private:
-        static const int MODE_USR = 0x00000000;
-        static const int MODE_SVR = 0x00000001;
-        static const int MODE_INT = 0x00000002;
-        static const int MODE_ABT = 0x00000003;
+        /**
+         * Prints how often each superinstruction was executed
+         */
+        void printFusionReport();
 
-        static const int ST_N = 0x80000000;
-        static const int ST_Z = 0x40000000;
-        static const int ST_C = 0x20000000;
-        static const int ST_V = 0x10000000;
+        /**
+         * Prints the instruction mix collected with setHistogram(true)
+         */
+        void printHistogram()
+        {
+            histogram.print(*out);
+        }
 
-        const unsigned int MAX_ADDRESS;
+        /**
+         * Collects an instruction mix from the next reset on. Instructions
+         *  are counted one at a time, so collection runs on the reference
+         *  engine whichever engine is selected.
+         */
+        void setHistogram(bool enabled)
+        {
+            histogramEnabled = enabled;
+        }
 
-        int reg_r[13];
-        int reg_sp[4];
-        int reg_lp[4];
-        int reg_pc;
-        int reg_st;
-        int reg_sv[4];
-        bool halt;
+        /**
+         * Records guest memory accesses per cache line from the next reset
+         *  on. Instruction fetches are recorded too, so recording runs on
+         *  the reference engine whichever engine is selected.
+         */
+        void setHeatmap(bool enabled)
+        {
+            heatmapEnabled = enabled;
+            observed = heatmapEnabled || !watchpoints.empty();
+        }
 
-        char *mem;
-        size_t instructionsExecuted;
+        /**
+         * Returns the accesses recorded with setHeatmap(true)
+         */
+        Heatmap &getHeatmap()
+        {
+            return heatmap;
+        }
 
-        Bios bios;
+        /**
+         * Builds a call-graph profile from the next reset on. Calls and
+         *  returns are followed one instruction at a time, so profiling
+         *  runs on the reference engine whichever engine is selected.
+         */
+        void setCallGraph(bool enabled)
+        {
+            callGraphEnabled = enabled;
+        }
 
-        bool isCondition(int instr);
-        void simulateData(int instr);
-        void simulateLoad(int instr);
-        void simulateBranch(int instr);
-        void simulateSwi(int instr);
+        /**
+         * Returns the profile built with setCallGraph(true)
+         */
+        CallGraph &getCallGraph()
+        {
+            return callGraph;
+        }
 
-        inline int getMode()
+        /**
+         * Returns the size of the loaded image
+         */
+        size_t getImageSize() const
+        {
+            return imageSize;
+        }
+
+        Engine getEngine() const
+        {
+            return engine;
+        }
+
+        void setEngine(Engine engine)
+        {
+            this->engine = engine;
+        }
+
+        /**
+         * Selects what undefined instructions and aborts do. Off (the
+         *  default), they stop run() with their status. On, they enter abort
+         *  mode like hardware: SV_abt takes ST, LP_abt the address of the
+         *  faulting instruction (or the unfetchable PC), and execution
+         *  continues at the exception's vector. An exception in abort mode
+         *  still stops run(). The interpreters check accesses and decode
+         *  up front and raise these without unwinding; translated code and
+         *  batch lanes unwind through a C++ exception on a data abort
+         *  instead.
+         */
+        void setVectoring(bool vectoring)
         {
-            if ((reg_st & MODE_ABT) == MODE_SVR)
+            this->vectoring = vectoring;
+        }
+
+        void setFusion(bool fusion)
+        {
+            this->fusion = fusion;
+            for (auto &d : decoded)
             {
-                return 1;
+                d.length = 0;
             }
-            else if ((reg_st & MODE_ABT) == MODE_INT)
+        }
+
+        /**
+         * Sets when the tiered engine promotes a block: to the predecoded
+         *  engine once it was entered predecode times on the reference
+         *  engine, then to its translation (if one is installed) after
+         *  translate more entries
+         */
+        void setTierThresholds(uint32_t predecode, uint32_t translate)
+        {
+            predecodeThreshold = std::max(predecode, (uint32_t) 1);
+            translateThreshold = std::max(translate, (uint32_t) 1);
+        }
+
+        /**
+         * Prints the instructions run on each tier and every promotion made
+         *  by the tiered engine
+         */
+        void printTierReport();
+
+        /**
+         * Installs natively compiled blocks and selects the translated
+         *  engine. Code without a translation runs on the predecoded engine.
+         *  If the tiered engine is selected, it stays selected and runs a
+         *  block's translation once the block is hot.
+         * @param blocks Translated blocks
+         * @param count Number of blocks
+         */
+        void setTranslation(const TranslatedBlock *blocks, size_t count);
+
+        size_t getInstructionsExecuted() const
+        {
+            return instructionsExecuted;
+        }
+
+        /**
+         * Returns how many of the instructions executed are idle loop
+         *  iterations that were skipped rather than run. They count towards
+         *  the instruction counter and run() limits, but took no host time.
+         */
+        size_t getInstructionsSkipped() const
+        {
+            return instructionsSkipped;
+        }
+
+        /**
+         * Returns true if the last run() ended by skipping an idle loop to
+         *  its limit, so running again soon would only skip further
+         */
+        bool isIdle() const
+        {
+            return idle;
+        }
+
+        unsigned int getCoreId() const
+        {
+            return coreId;
+        }
+
+        /**
+         * Returns the wall time spent in run() since the last reset
+         */
+        std::chrono::steady_clock::duration getRunTime() const
+        {
+            return runTime;
+        }
+
+        size_t getMemorySize() const
+        {
+            return (size_t) MAX_ADDRESS + 1;
+        }
+
+        const char *getMemory() const
+        {
+            return mem;
+        }
+
+        /**
+         * Returns the pages (of PAGE_BYTES) written since checkpoint()
+         */
+        const std::vector<unsigned int> &getDirtyPages() const
+        {
+            return dirtyPages;
+        }
+
+        /**
+         * Forgets the pages written so far, without the copy checkpoint()
+         *  takes (for callers that keep their own copy, such as History)
+         */
+        void clearDirtyPages();
+
+        /**
+         * Traps guest loads and/or stores that overlap [addr, addr + size).
+         *  Only accesses to the pages the range covers check the ranges.
+         *  run() returns WATCHPOINT once the accessing instruction completes,
+         *  also within a fused sequence; only translated blocks, which cannot
+         *  stop there, give way to the reference engine while any watchpoint
+         *  is armed. Instruction fetches and host accesses
+         *  (readMemory, writeMemory) never trap.
+         * @return False if the range is empty or outside of memory
+         */
+        bool addWatchpoint(unsigned int addr, size_t size, Access access);
+
+        void clearWatchpoints();
+
+        /**
+         * Makes run() return BREAKPOINT before executing the word at addr,
+         *  unless the run starts there. The predecoded and translated
+         *  engines pay nothing for it: the word decodes to a breakpoint
+         *  entry, and sequences and blocks that cover it fall back to
+         *  single instructions. Only the reference engine looks the pc up,
+         *  and only while any breakpoint is set.
+         * @return False if addr is unaligned or outside of memory
+         */
+        bool addBreakpoint(unsigned int addr);
+
+        /**
+         * @return False if no breakpoint is set at addr
+         */
+        bool removeBreakpoint(unsigned int addr);
+
+        void clearBreakpoints();
+
+        /**
+         * Returns the access that made run() return WATCHPOINT
+         */
+        const WatchHit &getWatchHit() const
+        {
+            return watchHit;
+        }
+
+        /**
+         * Copies guest memory into buffer
+         * @return False if the range is outside of memory
+         */
+        bool readMemory(unsigned int addr, char *buffer, size_t size) const;
+
+        /**
+         * Copies buffer into guest memory, dropping stale decodings
+         * @return False if the range is outside of memory
+         */
+        bool writeMemory(unsigned int addr, const char *buffer, size_t size);
+
+        // Primitives used by translated code --------------------------------
+
+        Registers &getRegisters()
+        {
+            return regs;
+        }
+
+        bool isHalted() const
+        {
+            return halt;
+        }
+
+        bool isTranslated(unsigned int addr) const
+        {
+            return translated[addr >> 2] != nullptr;
+        }
+
+        void retire()
+        {
+            ++instructionsExecuted;
+        }
+
+        void retire(size_t count)
+        {
+            instructionsExecuted += count;
+        }
+
+        /**
+         * Forgets an exception execute() raised outside of run(), for
+         *  callers that repeat the instruction on run() instead
+         * @return False if there was none
+         */
+        bool clearException()
+        {
+            if (pending == Status::RUNNING)
             {
-                return 2;
+                return false;
             }
-            else if ((reg_st & MODE_ABT) == MODE_ABT)
+            pending = Status::RUNNING;
+            halt = false;
+            return true;
+        }
+
+        bool hasBudget() const
+        {
+            return instructionsExecuted < stopAt;
+        }
+
+        void execute(int instr);
+        void serviceSwi(int vector);
+        void updateStatus(long long aluReg, int aluA, int aluB);
+        bool checkCondition(int cond);
+
+        /**
+         * Returns st with its condition flags set from an ALU result
+         */
+        static int nextStatus(int st, long long aluReg, int aluA, int aluB)
+        {
+            static const long long MASK = 0xFFFFFFFF;
+            static const long long NEGATIVE = 0x0000000080000000;
+            static const long long CARRY = 0xFFFFFFFF00000000;
+            static const int OVERFLOW = 0x80000000;
+
+            int status = 0;
+            status |= (aluReg & NEGATIVE) == NEGATIVE ? 0x80000000 : 0x0;
+            status |= (aluReg & MASK) == 0 ? 0x40000000 : 0x0;
+            status |= (aluReg & CARRY) != 0 ? 0x20000000 : 0x0;
+            bool carryIn = (aluA & OVERFLOW) == OVERFLOW
+                           && (aluB & OVERFLOW) == OVERFLOW;
+            bool carryOut = (aluReg & NEGATIVE) == NEGATIVE;
+            status |= carryIn ^ carryOut;
+            return (st & 0x0FFFFFFF) | status;
+        }
+
+        /**
+         * Evaluates a defined condition code (0x0 to 0xE) against st
+         */
+        static bool testCondition(int st, int cond)
+        {
+            switch (cond & 0xF)
             {
-                return 3;
+                case 0x0:   // EQ
+                    return (st & ST_Z) != 0;
+                case 0x1:   // NE
+                    return (st & ST_Z) == 0;
+                case 0x2:   // CS
+                    return (st & ST_C) != 0;
+                case 0x3:   // CC
+                    return (st & ST_C) == 0;
+                case 0x4:   // MI
+                    return (st & ST_N) != 0;
+                case 0x5:   // PL
+                    return (st & ST_N) == 0;
+                case 0x6:   // VS
+                    return (st & ST_V) != 0;
+                case 0x7:   // VC
+                    return (st & ST_V) == 0;
+                case 0x8:   // HI
+                    return (st & ST_C) != 0 && (st & ST_Z) == 0;
+                case 0x9:   // LS
+                    return (st & ST_C) == 0 || (st & ST_Z) != 0;
+                case 0xA:   // GE
+                    return ((st & ST_N) >> 3) == (st & ST_V);
+                case 0xB:   // LT
+                    return ((st & ST_N) >> 3) != (st & ST_V);
+                case 0xC:   // GT
+                    return (st & ST_Z) == 0
+                           && ((st & ST_N) >> 3) == (st & ST_V);
+                case 0xD:   // LE
+                    return (st & ST_Z) != 0
+                           || ((st & ST_N) >> 3) != (st & ST_V);
+                default:    // AL
+                    return true;
             }
-            // MODE_USR
-            return 0;
         }
 
         int *getRegister(int reg)
         {
             if (reg >= 0 && reg <= 12)
             {
-                return reg_r + reg;
+                return regs.r + reg;
             }
             else if (reg == 13)
             {
-                return reg_sp + getMode();
+                return regs.sp + getMode();
             }
             else if (reg == 14)
             {
-                return reg_lp + getMode();
+                return regs.lp + getMode();
             }
             else if (reg == 15)
             {
-                return &reg_pc;
+                return &regs.pc;
             }
             throw UsageAbortException();
         }
@@ -238,12 +786,12 @@ namespace m20
         {
             if (reg == 0)
             {
-                return &reg_st;
+                return &regs.st;
             }
             else if (reg == 1)
             {
                 assert(getMode() != 0);
-                return reg_sv + getMode();
+                return regs.sv + getMode();
             }
             else
             {
@@ -256,66 +804,531 @@ namespace m20
         {
             if (!(addr >= 0 && addr <= MAX_ADDRESS - 3))
             {
-                throw DataAbortException();
+                dataAbort(addr);
             }
-            storeByte(addr, (char) ((val >> 24) & 0xFF));
-            storeByte(addr + 1, (char) ((val >> 16) & 0xFF));
-            storeByte(addr + 2, (char) ((val >> 8) & 0xFF));
-            storeByte(addr + 3, (char) (val & 0xFF));
+            if (observed)
+            {
+                int old = fetchWord(addr);
+                putWord(addr, val);
+                observe(addr, 4, Access::WRITE, old, val);
+                return;
+            }
+            putWord(addr, val);
         }
 
         void storeHalfword(int addr, int val)
         {
             if (!(addr >= 0 && addr <= MAX_ADDRESS - 1))
             {
-                throw DataAbortException();
+                dataAbort(addr);
+            }
+            if (observed)
+            {
+                int old = ((int) mem[addr] & 0xFF) << 8
+                          | ((int) mem[addr + 1] & 0xFF);
+                putHalfword(addr, val);
+                observe(addr, 2, Access::WRITE, old, val & 0xFFFF);
+                return;
             }
-            storeByte(addr, (char) ((val >> 8) & 0xFF));
-            storeByte(addr + 1, (char) (val & 0xFF));
+            putHalfword(addr, val);
         }
 
         void storeByte(int addr, int val)
         {
             if (!(addr >= 0 && addr <= MAX_ADDRESS))
             {
-                throw DataAbortException();
+                dataAbort(addr);
             }
-            mem[addr] = (char) (val & 0xFF);
+            if (observed)
+            {
+                int old = (int) mem[addr] & 0xFF;
+                putByte(addr, val);
+                observe(addr, 1, Access::WRITE, old, val & 0xFF);
+                return;
+            }
+            putByte(addr, val);
         }
 
         int loadWord(int addr)
         {
-            if (!(addr >= 0 && addr <= MAX_ADDRESS - 3))
+            int value = fetchWord(addr);
+            if (observed)
             {
-                throw DataAbortException();
+                observe(addr, 4, Access::READ, value, value);
             }
-            auto i0 = (unsigned int) mem[addr] & 0xFF;
-            auto i1 = (unsigned int) mem[addr + 1] & 0xFF;
-            auto i2 = (unsigned int) mem[addr + 2] & 0xFF;
-            auto i3 = (unsigned int) mem[addr + 3] & 0xFF;
-            return (int) ((unsigned) 0 | i0 << 24 | i1 << 16 | i2 << 8 | i3);
+            return value;
         }
 
         int loadHalfword(int addr)
         {
             if (!(addr >= 0 && addr <= MAX_ADDRESS - 1))
             {
-                throw DataAbortException();
+                dataAbort(addr);
             }
             auto i0 = (unsigned int) mem[addr] & 0xFF;
             auto i1 = (unsigned int) mem[addr + 1] & 0xFF;
-            return (int) ((unsigned) 0 | i0 << 8 | i1);
+            auto value = (int) ((unsigned) 0 | i0 << 8 | i1);
+            if (observed)
+            {
+                observe(addr, 2, Access::READ, value, value);
+            }
+            return value;
         }
 
         int loadByte(int addr)
         {
             if (!(addr >= 0 && addr <= MAX_ADDRESS))
             {
-                throw DataAbortException();
+                dataAbort(addr);
+            }
+            auto i0 = (unsigned int) mem[addr] & 0xFF;
+            auto value = (int) ((unsigned) 0 | i0);
+            if (observed)
+            {
+                observe(addr, 1, Access::READ, value, value);
+            }
+            return value;
+        }
+
+    private:
+        static const int MODE_USR = 0x00000000;
+        static const int MODE_SVR = 0x00000001;
+        static const int MODE_INT = 0x00000002;
+        static const int MODE_ABT = 0x00000003;
+
+        static const int ST_N = 0x80000000;
+        static const int ST_Z = 0x40000000;
+        static const int ST_C = 0x20000000;
+        static const int ST_V = 0x10000000;
+
+        const unsigned int MAX_ADDRESS;
+
+        Registers regs;
+        bool halt;
+        Status status;
+
+        char *mem;
+        size_t mappedSize;
+        size_t instructionsExecuted;
+        size_t instructionsSkipped;         // Of those, skipped idle loops
+        bool idle;
+        size_t stopAt;
+        std::chrono::steady_clock::duration runTime;
+
+        std::ostream *out;
+
+        std::vector<char> baseline;
+        std::vector<bool> dirty;
+        std::vector<unsigned int> dirtyPages;
+
+        Bios bios;
+
+        ControlFlowGraph cfg;
+
+        Engine engine;
+        bool fusion;
+        std::vector<DecodedInstruction> decoded;
+        size_t fusionHits[FUSION_COUNT];
+        size_t idleInstructions;            // Run in idle loops
+
+        bool histogramEnabled;
+        Histogram histogram;
+
+        std::vector<void (*)(Simulator &, Registers &)> translated;
+        std::vector<int> translatedHead;
+
+        // Pages holding decoded or translated code; stores anywhere else
+        // skip invalidate
+        static const uint8_t CODE_DECODED = 1;
+        static const uint8_t CODE_TRANSLATED = 2;
+        std::vector<uint8_t> codePages;
+
+        struct Promotion
+        {
+            unsigned int address;           // Head of the block
+            Engine tier;                    // Promoted to
+            size_t instruction;             // Instructions executed before
+        };
+
+        // Engine::TIERED keeps installed translations dormant until their
+        // block is hot, and leaves cold words undecoded
+        std::vector<void (*)(Simulator &, Registers &)> dormant;
+        std::vector<Engine> tiers;          // Per word
+        std::vector<uint32_t> heat;         // Entries counted per block head
+        int coldNext;                       // Not an entry: falls through
+        uint32_t predecodeThreshold;
+        uint32_t translateThreshold;
+        size_t tierInstructions[3];         // By Engine, see printTierReport
+        std::vector<Promotion> promotions;
+
+        struct Watchpoint
+        {
+            unsigned int begin;
+            unsigned int end;
+            Access access;
+        };
+
+        std::vector<Watchpoint> watchpoints;
+        std::vector<uint8_t> watchedPages;  // Access bits of any watchpoint
+        WatchHit watchHit;
+        bool watchTriggered;
+        bool heatmapEnabled;
+        Heatmap heatmap;
+        bool observed;      // Loads and stores go through observe()
+        bool callGraphEnabled;
+        CallGraph callGraph;
+        std::vector<uint8_t> breakpoints;   // Per word
+        size_t breakpointCount;
+        bool breakpointHit;
+        size_t resumeCount;     // Instruction count the run started at
+        size_t imageSize;
+
+        Simulator *primary;                 // Core 0, owner of memory
+        unsigned int coreId;
+        std::vector<Simulator *> cores;     // All cores (primary only)
+        std::atomic<uint32_t> interrupts;   // Pending IPIs, bit per sender
+        std::mutex biosLock;                // Serializes BIOS output
+        std::vector<uint32_t> codeCores;    // Per page, bit per core with
+                                            // code there (primary, SMP only)
+        uint32_t *sharedCode;               // Primary's codeCores, if SMP
+        std::mutex codeWriteLock;
+        std::vector<int> codeWrites;        // Other cores' stores into code
+        std::atomic<bool> codeWritten;      // codeWrites is not empty
+        bool exclusive;                     // ldrex reservation held
+        int exclusiveAddress;
+        uint32_t exclusiveValue;            // Word ldrex read, as in memory
+        bool vectoring;
+        Status pending;                     // Exception raised, not yet taken
+        int faultPc;
+        size_t faultCount;                  // Instructions before the fault
+        int faultAddress;                   // Of the last data abort (far)
+
+        static size_t roundToPage(size_t size);
+        static int divide(int a, int b);
+        static int divideUnsigned(int a, int b);
+        void restart();
+        Status stop(Status status);
+        void sendInterrupt(unsigned int target);
+        void shareWrite(int addr);
+        void takeCodeWrites();
+        uint32_t *atomicWord(int addr);
+        int swapWord(int addr, int val);
+        int loadExclusive(int addr);
+        bool storeExclusive(int addr, int val);
+        Status dispatch(size_t steps);
+        bool atBreakpoint();
+        bool takeException();
+        void observe(int addr, unsigned int size, Access access, int oldValue,
+                     int newValue);
+        void watch(int addr, unsigned int size, Access access, int oldValue,
+                   int newValue);
+        void analyze(size_t size);
+        void step();
+        void stepPredecoded();
+        void stepTranslated();
+        DecodedInstruction *warm(size_t index);
+        void promote(size_t index, Engine tier);
+        void execute(const DecodedInstruction &d);
+        void executePredecoded(DecodedInstruction *d);
+        void executeGeneric(const DecodedInstruction &d);
+        void executeFused(DecodedInstruction *d);
+        void executeIdleLoop(DecodedInstruction *d);
+        DecodedInstruction &predecode(size_t index);
+
+        bool isCondition(int instr);
+        bool readStatus(int reg, int &val);
+        bool writeStatus(int reg, int val);
+        void simulateData(int instr);
+        void simulateLoad(int instr);
+        void simulateBranch(int instr);
+        void simulateSwi(int instr);
+
+        inline int getMode()
+        {
+            if ((regs.st & MODE_ABT) == MODE_SVR)
+            {
+                return 1;
+            }
+            else if ((regs.st & MODE_ABT) == MODE_INT)
+            {
+                return 2;
+            }
+            else if ((regs.st & MODE_ABT) == MODE_ABT)
+            {
+                return 3;
+            }
+            // MODE_USR
+            return 0;
+        }
+
+        /**
+         * Predecoded entries run through a handler specialized at compile
+         *  time for their op and operand form (Decoder::getHandler), so the
+         *  op switch, operand selection and status update test are resolved
+         *  once at decode instead of on every execution
+         */
+        using Handler = void (*)(Simulator &, const DecodedInstruction &);
+
+        static const std::array<Handler, HANDLER_COUNT> HANDLERS;
+
+        template <size_t... HANDLER>
+        static constexpr std::array<Handler, sizeof...(HANDLER)>
+        getHandlers(std::index_sequence<HANDLER...>);
+
+        template <unsigned int HANDLER>
+        static void executeHandler(Simulator &sim, const DecodedInstruction &d);
+
+        template <Op OP, bool IMMEDIATE, bool UPDATE>
+        void executeData(const DecodedInstruction &d);
+
+        template <Op OP, Address ADDRESS>
+        void executeMemory(const DecodedInstruction &d);
+
+        template <Op OP>
+        long long compute(int a, int b);
+
+        int getOperand(const DecodedInstruction &d)
+        {
+            return d.immediate ? d.imm : *getRegister(d.rm);
+        }
+
+        template <Address ADDRESS>
+        int getAddress(const DecodedInstruction &d)
+        {
+            switch (ADDRESS)
+            {
+                case Address::BASE_IMMEDIATE:
+                    return *getRegister(d.rn) + d.imm;
+                case Address::BASE_REGISTER:
+                    return *getRegister(d.rn) + *getRegister(d.rm);
+                case Address::PC_IMMEDIATE:
+                    return regs.pc + d.imm;
+                default:
+                    return *getRegister(d.rm);
+            }
+        }
+
+        /**
+         * Stops the current instruction with an exception without
+         *  unwinding: the engine loops see halt and return to dispatch(),
+         *  which takes it. The caller leaves registers and memory as they
+         *  were and returns.
+         */
+        void raise(Status exception)
+        {
+            raise(exception, regs.pc - 4);
+        }
+
+        void raise(Status exception, int pc)
+        {
+            if (pending == Status::RUNNING)
+            {
+                pending = exception;
+                faultPc = pc;
+                faultCount = instructionsExecuted;
+            }
+            halt = true;
+        }
+
+        /**
+         * Returns true if [addr, addr + size) lies in memory, and raises a
+         *  data abort otherwise
+         */
+        bool isMapped(int addr, unsigned int size)
+        {
+            if (addr >= 0 && (unsigned int) addr <= MAX_ADDRESS + 1 - size)
+            {
+                return true;
+            }
+            faultAddress = addr;
+            raise(Status::DATA_ABORT);
+            return false;
+        }
+
+        /**
+         * Returns true if b can divide (udv uses its low 12 bits), and raises
+         *  a usage abort for a zero divisor otherwise
+         */
+        bool isDivisor(int b, bool isUnsigned)
+        {
+            if ((isUnsigned ? b & 0xFFF : b) != 0)
+            {
+                return true;
+            }
+            raise(Status::USAGE_ABORT);
+            return false;
+        }
+
+        /**
+         * Throws a data abort, for the primitives translated code and batch
+         *  lanes call
+         */
+        [[noreturn]] void dataAbort(int addr)
+        {
+            faultAddress = addr;
+            throw DataAbortException();
+        }
+
+        void push(const DecodedInstruction &d)
+        {
+            *getRegister(13) -= 4;
+            if (!isMapped(*getRegister(13), 4))
+            {
+                *getRegister(13) += 4;
+                return;
+            }
+            storeWord(*getRegister(13), getOperand(d));
+        }
+
+        void pop(int reg)
+        {
+            if (isMapped(*getRegister(13), 4))
+            {
+                *getRegister(reg) = loadWord(*getRegister(13));
+                *getRegister(13) += 4;
+            }
+        }
+
+        /**
+         * Reads a word without checking watchpoints (instruction fetch).
+         *  Aligned words are read with one acquire load, so they are
+         *  single-copy atomic with respect to other cores.
+         */
+        int fetchWord(int addr)
+        {
+            if (!(addr >= 0 && addr <= MAX_ADDRESS - 3))
+            {
+                dataAbort(addr);
+            }
+            if ((addr & 3) == 0)
+            {
+                auto word = reinterpret_cast<uint32_t *>(mem + addr);
+                return (int) fromBigEndian(
+                        __atomic_load_n(word, __ATOMIC_ACQUIRE));
             }
             auto i0 = (unsigned int) mem[addr] & 0xFF;
-            return (int) ((unsigned) 0 | i0);
+            auto i1 = (unsigned int) mem[addr + 1] & 0xFF;
+            auto i2 = (unsigned int) mem[addr + 2] & 0xFF;
+            auto i3 = (unsigned int) mem[addr + 3] & 0xFF;
+            return (int) ((unsigned) 0 | i0 << 24 | i1 << 16 | i2 << 8 | i3);
         }
+
+        /**
+         * Writes a word; aligned words with one release store
+         */
+        void putWord(int addr, int val)
+        {
+            if ((addr & 3) == 0)
+            {
+                auto word = reinterpret_cast<uint32_t *>(mem + addr);
+                __atomic_store_n(word, fromBigEndian((uint32_t) val),
+                                 __ATOMIC_RELEASE);
+                written(addr);
+                return;
+            }
+            putByte(addr, (char) ((val >> 24) & 0xFF));
+            putByte(addr + 1, (char) ((val >> 16) & 0xFF));
+            putByte(addr + 2, (char) ((val >> 8) & 0xFF));
+            putByte(addr + 3, (char) (val & 0xFF));
+        }
+
+        /**
+         * Converts between guest (big endian) and host byte order
+         */
+        static uint32_t fromBigEndian(uint32_t word)
+        {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            return __builtin_bswap32(word);
+#else
+            return word;
+#endif
+        }
+
+        void putHalfword(int addr, int val)
+        {
+            putByte(addr, (char) ((val >> 8) & 0xFF));
+            putByte(addr + 1, (char) (val & 0xFF));
+        }
+
+        void putByte(int addr, int val)
+        {
+            mem[addr] = (char) (val & 0xFF);
+            written(addr);
+        }
+
+        /**
+         * Returns true if [addr, addr + size) lies on a page watched for
+         *  access. One table lookup per end of the range.
+         */
+        bool isWatched(int addr, unsigned int size, Access access) const
+        {
+            auto first = (unsigned int) addr >> PAGE_BITS;
+            auto last = ((unsigned int) addr + size - 1) >> PAGE_BITS;
+            return ((watchedPages[first] | watchedPages[last])
+                    & (uint8_t) access) != 0;
+        }
+
+        /**
+         * Marks a page as holding code of a kind (CODE_DECODED or
+         *  CODE_TRANSLATED). On a multiprocessor, stores by other cores to
+         *  the page are then passed on to this core.
+         */
+        void markCode(size_t page, uint8_t kind)
+        {
+            if (codePages[page] == 0 && sharedCode != nullptr)
+            {
+                __atomic_fetch_or(&sharedCode[page], 1u << coreId,
+                                  __ATOMIC_ACQ_REL);
+            }
+            codePages[page] |= kind;
+        }
+
+        /**
+         * Records a write to the word containing addr
+         */
+        void written(int addr)
+        {
+            auto page = (unsigned int) addr >> PAGE_BITS;
+            if (codePages[page] != 0)
+            {
+                invalidate(addr);
+            }
+            if (sharedCode != nullptr
+                && (__atomic_load_n(&sharedCode[page], __ATOMIC_ACQUIRE)
+                    & ~(1u << coreId)) != 0)
+            {
+                shareWrite(addr);
+            }
+
+            if (!dirty[page])
+            {
+                dirty[page] = true;
+                dirtyPages.push_back(page);
+            }
+        }
+
+        /**
+         * Drops cached decodings and translations that cover the word
+         *  containing addr. Only these entries are flushed: the rest of
+         *  the page keeps running from the cache.
+         */
+        void invalidate(int addr)
+        {
+            auto word = (size_t) addr >> 2;
+            for (size_t k = 0; k < Decoder::MAX_FUSION && k <= word; ++k)
+            {
+                if (decoded[word - k].length > k)
+                {
+                    decoded[word - k].length = 0;
+                }
+            }
+            if (!translatedHead.empty() && translatedHead[word] >= 0)
+            {
+                translated[translatedHead[word]] = nullptr;
+                dormant[translatedHead[word]] = nullptr;
+            }
+        }
+
     };
 }
 
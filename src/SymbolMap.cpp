@@ -0,0 +1,101 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Symbol map written by the linker, used to name guest addresses.
+ *      (Implementation)
+ * =============================================================================
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include "SymbolMap.h"
+
+bool m20::SymbolMap::load(const std::string &fname)
+{
+    std::ifstream in(fname);
+    if (!in.is_open())
+    {
+        return false;
+    }
+
+    text.clear();
+    dataBegin = ~0u;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream fields(line);
+        Entry entry;
+        if (!(fields >> std::hex >> entry.address >> entry.type >> entry.name))
+        {
+            continue;
+        }
+        if (entry.type == 'T' || entry.type == 't')
+        {
+            text.push_back(entry);
+        }
+        else
+        {
+            dataBegin = std::min(dataBegin, entry.address);
+        }
+    }
+
+    std::stable_sort(text.begin(), text.end(),
+                     [](const Entry &a, const Entry &b)
+                     {
+                         return a.address < b.address;
+                     });
+    return true;
+}
+
+const m20::SymbolMap::Entry *m20::SymbolMap::find(unsigned int address) const
+{
+    auto i = std::upper_bound(text.begin(), text.end(), address,
+                              [](unsigned int a, const Entry &e)
+                              {
+                                  return a < e.address;
+                              });
+    if (i == text.begin())
+    {
+        return nullptr;
+    }
+
+    // Prefer a global over a local label at the same address
+    auto match = std::prev(i);
+    for (auto j = match; j->address == match->address; --j)
+    {
+        if (j->type == 'T')
+        {
+            return &*j;
+        }
+        if (j == text.begin())
+        {
+            break;
+        }
+    }
+    return &*match;
+}
+
+std::string m20::SymbolMap::describe(unsigned int address) const
+{
+    std::ostringstream ss;
+    const Entry *entry = find(address);
+    if (entry == nullptr)
+    {
+        ss << "0x" << std::hex << address;
+    }
+    else if (entry->address == address)
+    {
+        ss << entry->name;
+    }
+    else
+    {
+        ss << entry->name << "+0x" << std::hex << address - entry->address;
+    }
+    return ss.str();
+}
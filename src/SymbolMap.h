@@ -0,0 +1,77 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Symbol map written by the linker, used to name guest addresses.
+ * =============================================================================
+ */
+
+#ifndef M20_ASSEMBLY_SYMBOLMAP_H
+#define M20_ASSEMBLY_SYMBOLMAP_H
+
+#include <string>
+#include <vector>
+
+namespace m20
+{
+    /**
+     * Symbols of a linked executable, read from the <executable>.sym file
+     *  the linker writes next to it
+     */
+    class SymbolMap
+    {
+    public:
+        struct Entry
+        {
+            unsigned int address;
+            char type;              // T/t text, D/d data (lower case: local)
+            std::string name;
+        };
+
+        SymbolMap()
+                : dataBegin(~0u)
+        {
+            //
+        }
+
+        /**
+         * Reads a symbol map
+         * @param fname Symbol map (.sym)
+         * @return False if the file cannot be read
+         */
+        bool load(const std::string &fname);
+
+        /**
+         * Returns the text symbol covering address (the closest one at or
+         *  below it), or nullptr if there is none
+         */
+        const Entry *find(unsigned int address) const;
+
+        /**
+         * Formats address as symbol+offset, or as hex if it has no symbol
+         */
+        std::string describe(unsigned int address) const;
+
+        /**
+         * Returns the lowest data symbol, which the linker places right
+         *  after all text, or ~0u if there are no data symbols
+         */
+        unsigned int getDataBegin() const
+        {
+            return dataBegin;
+        }
+
+        bool empty() const
+        {
+            return text.empty();
+        }
+
+    private:
+        std::vector<Entry> text;
+        unsigned int dataBegin;
+    };
+}
+
+#endif // M20_ASSEMBLY_SYMBOLMAP_H
@@ -116,7 +116,8 @@ namespace m20
                        "|d[bhwd]|space|\\$)", std::regex_constants::icase),
             // REGISTER
             std::regex("(r10|r11|r12|r0|r1|r2|r3|r4|r5|r6|r7|r8|r9"
-                       "|sp|lp|pc|st|sv)", std::regex_constants::icase),
+                       "|sp|lp|pc|st|sv|ich|ic|cid|ipi|far)",
+                       std::regex_constants::icase),
             // COMMA
             std::regex(","),
             // DECLARE
@@ -141,7 +142,7 @@ namespace m20
                        "(eq|ne|cs|cc|mi|pl|vs|vc|hi|ls|ge|lt|gt|le|al)?",
                        std::regex_constants::icase),
             // MEM INSTRUCTION
-            std::regex("(ldrsb|ldrsh|ldrb|ldrh|ldr|strb|strh|str)"
+            std::regex("(ldrex|ldrsb|ldrsh|ldrb|ldrh|ldr|strex|strb|strh|str|swp)"
                        "(eq|ne|cs|cc|mi|pl|vs|vc|hi|ls|ge|lt|gt|le|al)?",
                        std::regex_constants::icase),
             // INSTRUCTION
@@ -0,0 +1,397 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Ahead-of-time translator from M20 executable images to C++.
+ *      (Implementation)
+ * =============================================================================
+ */
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "Translator.h"
+#include "Utils.h"
+
+namespace
+{
+    const unsigned int MEMORY_SIZE = 65536;
+    const uint8_t COND_AL = 0xE;
+
+    std::string hex(unsigned int value)
+    {
+        std::ostringstream ss;
+        ss << "0x" << std::hex << std::setw(8) << std::setfill('0') << value;
+        return ss.str();
+    }
+
+    std::string constant(int value)
+    {
+        return "(int) " + hex((unsigned int) value);
+    }
+
+    std::string blockName(unsigned int address)
+    {
+        return "block_" + hex(address).substr(2);
+    }
+}
+
+bool m20::Translator::translate(const std::string &infile,
+                                const std::string &outfile)
+{
+    std::ifstream in(infile, std::ios::ate | std::ios::binary);
+    if (!in.is_open())
+    {
+        std::cout << "Cannot open " << infile << std::endl;
+        return false;
+    }
+    auto size = (size_t) in.tellg();
+    if (size == 0 || size > MEMORY_SIZE)
+    {
+        std::cout << infile << ": image must be 1 to " << MEMORY_SIZE
+                  << " bytes" << std::endl;
+        return false;
+    }
+    image.resize(size);
+    in.seekg(0);
+    in.read(image.data(), size);
+    in.close();
+
+    cfg.build(image.data(), image.size(), 0);
+
+    std::ofstream out(outfile);
+    if (!out.is_open())
+    {
+        std::cout << "Cannot open " << outfile << std::endl;
+        return false;
+    }
+
+    out << "// Generated by aot from " << infile << ". Do not edit.\n\n"
+        << "#include \"Simulator.h\"\n\n"
+        << "namespace\n{\n";
+    emitImage(out);
+    for (const auto &i : cfg.getBlocks())
+    {
+        emitBlock(out, i.second);
+    }
+    out << "}\n\n";
+    emitMain(out);
+
+    return out.good();
+}
+
+void m20::Translator::emitImage(std::ostream &os) const
+{
+    os << "    const unsigned char IMAGE[] = {";
+    for (size_t i = 0; i < image.size(); ++i)
+    {
+        os << (i % 12 == 0 ? "\n            " : " ")
+           << "0x" << std::hex << std::setw(2) << std::setfill('0')
+           << ((unsigned int) image[i] & 0xFF) << ",";
+    }
+    os << std::dec << "\n    };\n";
+}
+
+void m20::Translator::emitBlock(std::ostream &os,
+                                const BasicBlock &block) const
+{
+    bool loop = false;
+    for (const auto &s : block.successors)
+    {
+        loop |= s == block.begin;
+    }
+
+    os << "\n    void " << blockName(block.begin)
+       << "(m20::Simulator &sim, m20::Registers &r)\n    {\n";
+    if (loop)
+    {
+        os << "        for (;;)\n        {\n";
+    }
+
+    for (unsigned int address = block.begin; address < block.end;
+         address += 4)
+    {
+        emitInstruction(os, block, address);
+    }
+
+    if (loop)
+    {
+        os << "        if (r.pc != " << constant(block.begin)
+           << " || !sim.hasBudget())\n"
+           << "        {\n"
+           << "            return;\n"
+           << "        }\n"
+           << "        }\n";
+    }
+    os << "    }\n";
+}
+
+void m20::Translator::emitInstruction(std::ostream &os,
+                                      const BasicBlock &block,
+                                      unsigned int address) const
+{
+    auto instr = (int) bytesToInt(image.data() + address);
+    DecodedInstruction d = Decoder::decode(instr);
+    std::string rd = getRegister(d.rd);
+    std::string rn = getRegister(d.rn);
+
+    std::ostringstream body;
+    std::string alu;
+    bool store = false;
+    bool raw = false;
+
+    switch (d.op)
+    {
+        case Op::ADD:
+            alu = "(int) ((unsigned int) a + (unsigned int) b)";
+            break;
+        case Op::ADC:
+            alu = "(int) ((unsigned int) a + (unsigned int) b"
+                  " + ((r.st & 0x20000000) != 0 ? 1u : 0u))";
+            break;
+        case Op::SUB:
+            alu = "(int) ((unsigned int) a - (unsigned int) b)";
+            break;
+        case Op::SBC:
+            alu = "(int) ((unsigned int) a - (unsigned int) b"
+                  " - ((r.st & 0x20000000) == 0 ? 1u : 0u))";
+            break;
+        case Op::MUL:
+            alu = "(int) ((unsigned int) a * (unsigned int) b)";
+            break;
+        case Op::OR:
+            alu = "a | b";
+            break;
+        case Op::AND:
+            alu = "a & b";
+            break;
+        case Op::XOR:
+            alu = "a ^ b";
+            break;
+        case Op::NOR:
+            alu = "~(a | b)";
+            break;
+        case Op::BIC:
+            alu = "a & ~b";
+            break;
+        case Op::MOV:
+            alu = "a";
+            break;
+        case Op::MVN:
+            alu = "~a";
+            break;
+        case Op::CMP:
+            alu = "(int) ((unsigned int) a - (unsigned int) b)";
+            break;
+        case Op::CMN:
+            alu = "(int) ((unsigned int) a + (unsigned int) b)";
+            break;
+        case Op::TST:
+            alu = "a & b";
+            break;
+        case Op::TEQ:
+            alu = "a ^ b";
+            break;
+        case Op::PUSH:
+            // sp moves only once the store succeeds, so an abort restarts
+            body << "int top = *sim.getRegister(13) - 4;\n"
+                 << "sim.storeWord(top, "
+                 << (!d.immediate && d.rm == 13 ? "top" : getOperand(d))
+                 << ");\n"
+                 << "*sim.getRegister(13) = top;\n";
+            if (d.update)
+            {
+                body << "sim.updateStatus(0, 0, 0);\n";
+            }
+            store = true;
+            break;
+        case Op::POP:
+            body << getRegister(d.rm)
+                 << " = sim.loadWord(*sim.getRegister(13));\n"
+                 << "*sim.getRegister(13) += 4;\n";
+            if (d.update)
+            {
+                body << "sim.updateStatus(0, 0, 0);\n";
+            }
+            break;
+        case Op::LDR:
+            body << rd << " = sim.loadWord(" << getAddress(d, address)
+                 << ");\n";
+            break;
+        case Op::LDRB:
+        case Op::LDRSB:
+            body << rd << " = sim.loadByte(" << getAddress(d, address)
+                 << ");\n";
+            break;
+        case Op::LDRH:
+        case Op::LDRSH:
+            body << rd << " = sim.loadHalfword(" << getAddress(d, address)
+                 << ");\n";
+            break;
+        case Op::STR:
+            body << "sim.storeWord(" << getAddress(d, address) << ", "
+                 << rd << ");\n";
+            store = true;
+            break;
+        case Op::STRB:
+            body << "sim.storeByte(" << getAddress(d, address) << ", "
+                 << rd << ");\n";
+            store = true;
+            break;
+        case Op::STRH:
+            body << "sim.storeHalfword(" << getAddress(d, address) << ", "
+                 << rd << ");\n";
+            store = true;
+            break;
+        case Op::B:
+        case Op::BWL:
+            if (d.op == Op::BWL)
+            {
+                body << "*sim.getRegister(14) = r.pc;\n";
+            }
+            body << "r.pc = "
+                 << (d.immediate ? constant((int) (address + 4 + d.imm))
+                                 : getRegister(d.rm))
+                 << ";\n";
+            break;
+        default:
+            // SWI, shifts, division and anything unusual run on the
+            // interpreter, which also checks the condition
+            raw = true;
+            break;
+    }
+
+    if (!alu.empty())
+    {
+        bool compare = d.op >= Op::CMP && d.op <= Op::TEQ;
+        bool move = d.op == Op::MOV || d.op == Op::MVN;
+        body << "int a = " << (move ? getOperand(d) : compare ? rd : rn)
+             << ";\n"
+             << "int b = " << (move ? "0" : getOperand(d)) << ";\n"
+             << "long long v = " << alu << ";\n";
+        if (!compare)
+        {
+            body << rd << " = (int) v;\n";
+        }
+        if (d.update)
+        {
+            body << "sim.updateStatus(v, a, b);\n";
+        }
+    }
+
+    os << "        // " << hex(address) << ": " << hex((unsigned int) instr)
+       << "\n"
+       << "        r.pc = " << constant((int) (address + 4)) << ";\n";
+    if (raw)
+    {
+        os << "        sim.execute(" << constant(instr) << ");\n"
+           << "        sim.retire();\n"
+           << "        if (sim.isHalted() || !sim.isTranslated("
+           << hex(block.begin) << "))\n"
+           << "        {\n"
+           << "            return;\n"
+           << "        }\n";
+        return;
+    }
+
+    // Indent the body into a scope, guarded by the condition if needed
+    std::string indent = "            ";
+    if (d.cond != COND_AL)
+    {
+        os << "        if (sim.checkCondition(" << (int) d.cond << "))\n";
+    }
+    os << "        {\n";
+    std::istringstream lines(body.str());
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        os << indent << line << "\n";
+    }
+    os << "        }\n"
+       << "        sim.retire();\n";
+
+    // A store may overwrite this block, in which case the interpreter
+    // resumes with the patched code
+    if (store)
+    {
+        os << "        if (!sim.isTranslated(" << hex(block.begin) << "))\n"
+           << "        {\n"
+           << "            return;\n"
+           << "        }\n";
+    }
+}
+
+void m20::Translator::emitMain(std::ostream &os) const
+{
+    os << "static const m20::TranslatedBlock BLOCKS[] = {\n";
+    for (const auto &i : cfg.getBlocks())
+    {
+        os << "        {" << hex(i.second.begin) << ", "
+           << hex(i.second.end) << ", " << blockName(i.second.begin)
+           << "},\n";
+    }
+    os << "};\n\n"
+       << "int main(int argc, char **argv)\n"
+       << "{\n"
+       << "    m20::Simulator simulator(" << MEMORY_SIZE << ");\n"
+       << "    bool tiered = argc > 1 && std::string(argv[1]) == "
+          "\"--engine=tiered\";\n"
+       << "    if (tiered)\n"
+       << "    {\n"
+       << "        simulator.setEngine(m20::Engine::TIERED);\n"
+       << "    }\n"
+       << "    if (!simulator.load(reinterpret_cast<const char *>(IMAGE),\n"
+       << "                        sizeof(IMAGE)))\n"
+       << "    {\n"
+       << "        return 1;\n"
+       << "    }\n"
+       << "    simulator.setTranslation(BLOCKS, "
+          "sizeof(BLOCKS) / sizeof(BLOCKS[0]));\n"
+       << "    simulator.simulate();\n"
+       << "    if (tiered)\n"
+       << "    {\n"
+       << "        simulator.printTierReport();\n"
+       << "    }\n"
+       << "    return 0;\n"
+       << "}\n";
+}
+
+std::string m20::Translator::getRegister(int reg)
+{
+    if (reg == 13 || reg == 14)
+    {
+        // Banked by mode, which may change between instructions
+        return "*sim.getRegister(" + std::to_string(reg) + ")";
+    }
+    else if (reg == 15)
+    {
+        return "r.pc";
+    }
+    return "r.r[" + std::to_string(reg) + "]";
+}
+
+std::string m20::Translator::getOperand(const DecodedInstruction &d)
+{
+    return d.immediate ? constant(d.imm) : getRegister(d.rm);
+}
+
+std::string m20::Translator::getAddress(const DecodedInstruction &d,
+                                        unsigned int address)
+{
+    switch (d.address)
+    {
+        case Address::BASE_IMMEDIATE:
+            return "(int) ((unsigned int) " + getRegister(d.rn) + " + "
+                   + hex((unsigned int) d.imm) + ")";
+        case Address::BASE_REGISTER:
+            return "(int) ((unsigned int) " + getRegister(d.rn)
+                   + " + (unsigned int) " + getRegister(d.rm) + ")";
+        case Address::PC_IMMEDIATE:
+            return constant((int) (address + 4 + d.imm));
+        default:
+            return getRegister(d.rm);
+    }
+}
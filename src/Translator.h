@@ -0,0 +1,60 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Ahead-of-time translator from M20 executable images to C++.
+ * =============================================================================
+ */
+
+#ifndef M20_ASSEMBLY_TRANSLATOR_H
+#define M20_ASSEMBLY_TRANSLATOR_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ControlFlowGraph.h"
+#include "Decoder.h"
+
+namespace m20
+{
+    /**
+     * Translates every basic block discovered in an executable image into
+     *  a C++ function. The generated program embeds the image, installs the
+     *  blocks into a Simulator and runs it; code that is only reached
+     *  indirectly, or that is overwritten at runtime, falls back to the
+     *  interpreter.
+     */
+    class Translator
+    {
+    public:
+        Translator() = default;
+
+        /**
+         * Translates an executable image into a C++ program
+         * @param infile Executable image (.mc)
+         * @param outfile Generated C++ source
+         * @return True if the translation succeeded
+         */
+        bool translate(const std::string &infile, const std::string &outfile);
+
+    private:
+        std::vector<char> image;
+        ControlFlowGraph cfg;
+
+        void emitImage(std::ostream &os) const;
+        void emitBlock(std::ostream &os, const BasicBlock &block) const;
+        void emitInstruction(std::ostream &os, const BasicBlock &block,
+                             unsigned int address) const;
+        void emitMain(std::ostream &os) const;
+
+        static std::string getRegister(int reg);
+        static std::string getOperand(const DecodedInstruction &d);
+        static std::string getAddress(const DecodedInstruction &d,
+                                      unsigned int address);
+    };
+}
+
+#endif // M20_ASSEMBLY_TRANSLATOR_H
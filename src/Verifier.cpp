@@ -0,0 +1,198 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Lockstep differential checker between simulator execution engines.
+ *      (Implementation)
+ * =============================================================================
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+
+#include "Decoder.h"
+#include "Utils.h"
+#include "Verifier.h"
+
+namespace
+{
+    std::ostream &word(std::ostream &os, unsigned int value)
+    {
+        return os << std::hex << std::setw(8) << std::setfill('0') << value
+                  << std::dec << std::setfill(' ');
+    }
+}
+
+bool m20::Verifier::verify(Status &status)
+{
+    subject.reset();
+    reference.reset();
+
+    status = Status::RUNNING;
+    while (status == Status::RUNNING)
+    {
+        auto pc = (unsigned int) subject.getRegisters().pc;
+        size_t before = subject.getInstructionsExecuted();
+
+        status = subject.run(1);
+        size_t count = subject.getInstructionsExecuted();
+
+        // Catch the reference up, then let it reach the same abort
+        Status expected = reference.run(
+                count - std::min(count, reference.getInstructionsExecuted()));
+        if (status != Status::RUNNING && expected == Status::RUNNING)
+        {
+            expected = reference.run(1);
+        }
+
+        size_t steps = count - before;
+        if (expected != status
+            || reference.getInstructionsExecuted() != count)
+        {
+            printDivergence(pc, steps);
+            out << "  status      : " << getStatusName(status)
+                << " after " << count << " instructions (engine), "
+                << getStatusName(expected) << " after "
+                << reference.getInstructionsExecuted()
+                << " instructions (reference)\n" << std::flush;
+            return false;
+        }
+        if (!compareRegisters(pc, steps))
+        {
+            return false;
+        }
+
+        // Memory is compared whenever control leaves straight-line code
+        bool transfer = (unsigned int) subject.getRegisters().pc
+                        != pc + 4 * steps;
+        if ((transfer || status != Status::RUNNING)
+            && !compareMemory(pc, steps))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool m20::Verifier::compareRegisters(unsigned int pc, size_t count)
+{
+    static const char *const BANKS[] = {"usr", "svr", "int", "abt"};
+
+    const Registers &a = subject.getRegisters();
+    const Registers &b = reference.getRegisters();
+    std::vector<std::pair<std::string, std::pair<int, int>>> diffs;
+
+    for (int i = 0; i < 13; ++i)
+    {
+        if (a.r[i] != b.r[i])
+        {
+            diffs.push_back({"r" + std::to_string(i), {a.r[i], b.r[i]}});
+        }
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        if (a.sp[i] != b.sp[i])
+        {
+            diffs.push_back({std::string("sp_") + BANKS[i],
+                             {a.sp[i], b.sp[i]}});
+        }
+        if (a.lp[i] != b.lp[i])
+        {
+            diffs.push_back({std::string("lp_") + BANKS[i],
+                             {a.lp[i], b.lp[i]}});
+        }
+        if (i > 0 && a.sv[i] != b.sv[i])
+        {
+            diffs.push_back({std::string("sv_") + BANKS[i],
+                             {a.sv[i], b.sv[i]}});
+        }
+    }
+    if (a.pc != b.pc)
+    {
+        diffs.push_back({"pc", {a.pc, b.pc}});
+    }
+    if (a.st != b.st)
+    {
+        diffs.push_back({"st", {a.st, b.st}});
+    }
+
+    if (diffs.empty())
+    {
+        return true;
+    }
+
+    printDivergence(pc, count);
+    for (const auto &diff : diffs)
+    {
+        out << "  " << std::left << std::setw(12) << diff.first << std::right
+            << ": ";
+        word(out, (unsigned int) diff.second.first) << " (engine), ";
+        word(out, (unsigned int) diff.second.second) << " (reference)\n";
+    }
+    out << std::flush;
+    return false;
+}
+
+bool m20::Verifier::compareMemory(unsigned int pc, size_t count)
+{
+    const char *a = subject.getMemory();
+    const char *b = reference.getMemory();
+    size_t size = subject.getMemorySize();
+
+    for (const auto *pages : {&subject.getDirtyPages(),
+                              &reference.getDirtyPages()})
+    {
+        for (const auto &page : *pages)
+        {
+            size_t begin = (size_t) page << Simulator::PAGE_BITS;
+            size_t end = std::min(begin + Simulator::PAGE_BYTES, size);
+            if (std::memcmp(a + begin, b + begin, end - begin) == 0)
+            {
+                continue;
+            }
+
+            size_t addr = begin;
+            while (a[addr] == b[addr])
+            {
+                ++addr;
+            }
+            printDivergence(pc, count);
+            out << "  mem[0x";
+            word(out, (unsigned int) addr) << "]: "
+                    << std::hex << std::setw(2) << std::setfill('0')
+                    << ((unsigned int) a[addr] & 0xFF) << " (engine), "
+                    << std::setw(2) << ((unsigned int) b[addr] & 0xFF)
+                    << " (reference)\n" << std::dec << std::setfill(' ')
+                    << std::flush;
+            return false;
+        }
+    }
+    return true;
+}
+
+void m20::Verifier::printDivergence(unsigned int pc, size_t count)
+{
+    out << ">>>>> Engines diverged after "
+        << reference.getInstructionsExecuted() << " instructions\n"
+        << "  step from 0x";
+    word(out, pc) << ":\n";
+
+    const char *mem = reference.getMemory();
+    size_t size = reference.getMemorySize();
+    for (size_t i = 0; i < std::max(count, (size_t) 1); ++i)
+    {
+        auto addr = (unsigned int) (pc + 4 * i);
+        if (addr % 4 != 0 || (size_t) addr + 4 > size)
+        {
+            break;
+        }
+        out << "    0x";
+        word(out, addr) << ": "
+                << Decoder::disassemble((int) bytesToInt(mem + addr), addr)
+                << "\n";
+    }
+}
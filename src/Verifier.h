@@ -0,0 +1,56 @@
+/* =============================================================================
+ * M20 Assembly
+ *
+ * Author: Matthew Edwards (msedwar)
+ * Date:   October 18, 2026
+ * Description:
+ *      Lockstep differential checker between simulator execution engines.
+ * =============================================================================
+ */
+
+#ifndef M20_ASSEMBLY_VERIFIER_H
+#define M20_ASSEMBLY_VERIFIER_H
+
+#include <iostream>
+
+#include "Simulator.h"
+
+namespace m20
+{
+    /**
+     * Runs a simulator under test in lockstep with a reference simulator
+     *  loaded with the same image. After every step of the engine under
+     *  test the reference catches up to the same instruction count and the
+     *  registers are compared; at every control transfer the pages either
+     *  side has written are compared as well.
+     */
+    class Verifier
+    {
+    public:
+        Verifier(Simulator &subject, Simulator &reference, std::ostream &out)
+                : subject(subject),
+                  reference(reference),
+                  out(out)
+        {
+            //
+        }
+
+        /**
+         * Resets both simulators and runs them until the subject stops
+         * @param status Result of the subject's run
+         * @return False if the simulators diverged (reported to out)
+         */
+        bool verify(Status &status);
+
+    private:
+        Simulator &subject;
+        Simulator &reference;
+        std::ostream &out;
+
+        bool compareRegisters(unsigned int pc, size_t count);
+        bool compareMemory(unsigned int pc, size_t count);
+        void printDivergence(unsigned int pc, size_t count);
+    };
+}
+
+#endif // M20_ASSEMBLY_VERIFIER_H
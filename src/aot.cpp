@@ -0,0 +1,20 @@
+//
+// Created by Matthew Edwards on 10/18/26.
+//
+#include <cassert>
+
+#include "Translator.h"
+
+int main(int argc, char **argv)
+{
+    using namespace m20;
+
+    assert(argc == 3);
+    std::string infile(argv[1]);
+    std::string outfile(argv[2]);
+
+    Translator translator;
+    bool success = translator.translate(infile, outfile);
+
+    return success ? 0 : 1;
+}
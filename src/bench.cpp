@@ -0,0 +1,337 @@
+//
+// Created by Matthew Edwards on 10/18/26.
+//
+// Microbenchmarks for the simulator. Each benchmark isolates one cost:
+// guest benchmarks run a synthetic instruction stream (one instruction
+// repeated through an unrolled loop) on every engine, host benchmarks call
+// a single Simulator primitive in a tight loop. Results are printed as JSON
+// in nanoseconds per instruction (or per call), taking the fastest of
+// several repetitions so numbers are stable enough to compare commits.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Batch.h"
+#include "Simulator.h"
+#include "Utils.h"
+
+namespace
+{
+    const size_t MEMORY_SIZE = 65536;
+    const size_t DEFAULT_STEPS = 2000000;
+    const int REPETITIONS = 5;
+    const int UNROLL = 64;
+    const unsigned int BATCH_LANES = 64;
+
+    const unsigned int COND_NE = 0x1;
+    const unsigned int COND_AL = 0xE;
+
+    const unsigned int DATA_ADD = 0x01;
+    const unsigned int DATA_SUB = 0x03;
+    const unsigned int DATA_MUL = 0x05;
+    const unsigned int DATA_UDV = 0x07;
+    const unsigned int DATA_LSL = 0x0E;
+    const unsigned int DATA_MOV = 0x11;
+    const unsigned int DATA_CMP = 0x13;
+
+    const unsigned int LOAD_LDR = 0x0;
+    const unsigned int LOAD_STR = 0x5;
+
+    const unsigned int SWI_BIOS = 0x10;
+
+    // Instruction encoders ---------------------------------------------------
+
+    int data(unsigned int opcode, int rd, int rn, int operand,
+             bool immediate, bool update = false, unsigned int cond = COND_AL)
+    {
+        unsigned int mask = opcode == DATA_MOV ? 0xFFFF : 0xFFF;
+        return (int) (cond << 28
+                      | (update ? 0x04000000u : 0)
+                      | (immediate ? 0x02000000u : 0)
+                      | opcode << 20
+                      | (unsigned int) rd << 16
+                      | (unsigned int) rn << 12
+                      | ((unsigned int) operand & mask));
+    }
+
+    int load(unsigned int opcode, int rd, int rn, int offset)
+    {
+        return (int) (COND_AL << 28 | 0x08000000u | 0x02000000u | 0x01000000u
+                      | opcode << 20
+                      | (unsigned int) rd << 16
+                      | (unsigned int) rn << 12
+                      | ((unsigned int) offset & 0xFFF));
+    }
+
+    int branch(unsigned int from, unsigned int to)
+    {
+        auto offset = (int) (to - (from + 4));
+        return (int) (COND_AL << 28 | 0x0C000000u | 0x00800000u
+                      | (((unsigned int) offset >> 2) & 0x007FFFFF));
+    }
+
+    int swi(unsigned int vector)
+    {
+        return (int) (COND_AL << 28 | 0x0F000000u | (vector & 0x00FFFFFF));
+    }
+
+    /**
+     * A guest benchmark: setup code followed by body repeated UNROLL times
+     *  in a loop
+     */
+    struct Stream
+    {
+        std::string name;
+        std::vector<int> setup;
+        std::vector<int> body;
+    };
+
+    std::vector<char> buildImage(const Stream &stream)
+    {
+        std::vector<int> code(stream.setup);
+        auto loop = (unsigned int) (code.size() * 4);
+        for (int i = 0; i < UNROLL; ++i)
+        {
+            code.insert(code.end(), stream.body.begin(), stream.body.end());
+        }
+        code.push_back(branch((unsigned int) (code.size() * 4), loop));
+
+        std::vector<char> image(code.size() * 4);
+        for (size_t i = 0; i < code.size(); ++i)
+        {
+            m20::intToBytes((unsigned int) code[i], image.data() + i * 4);
+        }
+        return image;
+    }
+
+    std::vector<Stream> getStreams()
+    {
+        const int R1 = 1;
+        const int R2 = 2;
+        const int R3 = 3;
+        const int R4 = 4;
+        const std::vector<int> operands = {
+                data(DATA_MOV, R2, 0, 3, true),
+                data(DATA_MOV, R3, 0, 7, true),
+                data(DATA_MOV, R4, 0, 0x4000, true)
+        };
+
+        return {
+                {"dispatch.add_imm", operands,
+                        {data(DATA_ADD, R1, R1, 1, true)}},
+                {"dispatch.add_reg", operands,
+                        {data(DATA_ADD, R1, R1, R2, false)}},
+                {"dispatch.add_s", operands,
+                        {data(DATA_ADD, R1, R1, 1, true, true)}},
+                {"dispatch.mov", operands,
+                        {data(DATA_MOV, R1, 0, 42, true)}},
+                {"dispatch.mul", operands,
+                        {data(DATA_MUL, R1, R2, R3, false)}},
+                {"dispatch.udv", operands,
+                        {data(DATA_UDV, R1, R3, R2, false)}},
+                {"dispatch.lsl", operands,
+                        {data(DATA_LSL, R1, R2, 1, true)}},
+                {"dispatch.cmp", operands,
+                        {data(DATA_CMP, R2, 0, R3, false)}},
+                {"condition.not_taken",
+                        {data(DATA_SUB, R1, R1, R1, false, true)},
+                        {data(DATA_ADD, R1, R1, 1, true, false, COND_NE)}},
+                {"memory.ldr", operands,
+                        {load(LOAD_LDR, R1, R4, 0)}},
+                {"memory.str", operands,
+                        {load(LOAD_STR, R1, R4, 0)}},
+                {"register.banked", operands,
+                        {data(DATA_ADD, 14, 13, 0, true)}},
+                {"swi.bios", operands,
+                        {swi(SWI_BIOS)}}
+        };
+    }
+
+    template <typename P, typename F>
+    double fastest(P prepare, F run)
+    {
+        double best = 0;
+        for (int i = 0; i < REPETITIONS; ++i)
+        {
+            prepare();
+            auto begin = std::chrono::steady_clock::now();
+            run();
+            auto end = std::chrono::steady_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(
+                    end - begin).count();
+            best = i == 0 ? ns : std::min(best, ns);
+        }
+        return best;
+    }
+
+    void printResult(bool &first, const std::string &name,
+                     const std::string &engine, double ns)
+    {
+        std::cout << (first ? "" : ",\n") << "    {\"name\": \"" << name
+                  << "\", \"engine\": \"" << engine
+                  << "\", \"ns_per_op\": " << ns << "}";
+        first = false;
+    }
+
+    void runStreams(bool &first, size_t steps, const std::string &filter)
+    {
+        static const std::pair<const char *, m20::Engine> ENGINES[] = {
+                {"reference", m20::Engine::REFERENCE},
+                {"predecoded", m20::Engine::PREDECODED},
+                {"tiered", m20::Engine::TIERED}
+        };
+
+        std::ostream discard(nullptr);
+        for (const auto &stream : getStreams())
+        {
+            if (stream.name.find(filter) == std::string::npos)
+            {
+                continue;
+            }
+
+            std::vector<char> image = buildImage(stream);
+            for (const auto &engine : ENGINES)
+            {
+                m20::Simulator simulator(MEMORY_SIZE);
+                simulator.setOutput(discard);
+                simulator.setEngine(engine.second);
+                if (!simulator.load(image.data(), image.size()))
+                {
+                    continue;
+                }
+
+                size_t executed = 0;
+                double ns = fastest([&]()
+                {
+                    simulator.reset();
+                }, [&]()
+                {
+                    simulator.run(steps);
+                    executed = simulator.getInstructionsExecuted();
+                });
+                printResult(first, stream.name, engine.first,
+                            ns / (double) std::max(executed, (size_t) 1));
+            }
+
+            // Per instruction of any lane, for the same total work
+            m20::Batch batch(MEMORY_SIZE, BATCH_LANES);
+            if (!batch.load(image.data(), image.size()))
+            {
+                continue;
+            }
+            size_t executed = 0;
+            double ns = fastest([&]()
+            {
+                batch.reset();
+            }, [&]()
+            {
+                batch.run(std::max(steps / BATCH_LANES, (size_t) 1));
+                executed = batch.getInstructionsExecuted();
+            });
+            printResult(first, stream.name, "batch",
+                        ns / (double) std::max(executed, (size_t) 1));
+        }
+    }
+
+    void runHost(bool &first, size_t steps, const std::string &filter)
+    {
+        std::ostream discard(nullptr);
+        m20::Simulator simulator(MEMORY_SIZE);
+        simulator.setOutput(discard);
+        simulator.reset();
+        volatile int sink = 0;
+
+        const std::vector<std::pair<std::string, std::function<void()>>>
+                benchmarks = {
+                {"host.loadWord", [&]()
+                {
+                    int sum = 0;
+                    for (size_t i = 0; i < steps; ++i)
+                    {
+                        sum += simulator.loadWord((int) (i * 4 & 0x7FFC));
+                    }
+                    sink = sum;
+                }},
+                {"host.storeWord", [&]()
+                {
+                    for (size_t i = 0; i < steps; ++i)
+                    {
+                        simulator.storeWord((int) (i * 4 & 0x7FFC), (int) i);
+                    }
+                }},
+                {"host.checkCondition", [&]()
+                {
+                    int taken = 0;
+                    for (size_t i = 0; i < steps; ++i)
+                    {
+                        taken += simulator.checkCondition((int) (i % 15));
+                    }
+                    sink = taken;
+                }},
+                {"host.getRegister", [&]()
+                {
+                    int sum = 0;
+                    for (size_t i = 0; i < steps; ++i)
+                    {
+                        sum += *simulator.getRegister((int) (i % 16));
+                    }
+                    sink = sum;
+                }}
+        };
+
+        for (const auto &benchmark : benchmarks)
+        {
+            if (benchmark.first.find(filter) == std::string::npos)
+            {
+                continue;
+            }
+            double ns = fastest([]()
+            {
+                //
+            }, benchmark.second);
+            printResult(first, benchmark.first, "host",
+                        ns / (double) steps);
+        }
+        (void) sink;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t steps = DEFAULT_STEPS;
+    std::string filter;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg.compare(0, 8, "--steps=") == 0)
+        {
+            steps = std::max(std::strtoul(arg.c_str() + 8, nullptr, 10), 1ul);
+        }
+        else if (arg.compare(0, 9, "--filter=") == 0)
+        {
+            filter = arg.substr(9);
+        }
+        else
+        {
+            std::cerr << "usage: bench [--steps=N] [--filter=NAME]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    bool first = true;
+    std::cout << "{\n  \"steps\": " << steps << ",\n  \"results\": [\n";
+    runStreams(first, steps, filter);
+    runHost(first, steps, filter);
+    std::cout << "\n  ]\n}" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+//
+// Created by Matthew Edwards on 10/18/26.
+//
+// libFuzzer entry point: every input is an executable image that is run on
+// a single long-lived simulator. Only the pages a run writes are rolled back
+// between inputs, so an iteration costs about as much as the code it runs.
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+#include "Simulator.h"
+
+namespace
+{
+    const size_t MEMORY_SIZE = 65536;
+    const size_t MAX_STEPS = 1024;
+
+    m20::Simulator &getSimulator()
+    {
+        static std::ostream discard(nullptr);
+        static m20::Simulator *simulator = nullptr;
+        if (simulator == nullptr)
+        {
+            simulator = new m20::Simulator(MEMORY_SIZE);
+            simulator->setOutput(discard);
+            simulator->reset();
+            simulator->checkpoint();
+        }
+        return *simulator;
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    m20::Simulator &simulator = getSimulator();
+    simulator.restore();
+
+    // Leave the halt handler at the top of memory intact
+    size = std::min(size, MEMORY_SIZE - 4);
+    simulator.writeMemory(0, reinterpret_cast<const char *>(data), size);
+    simulator.run(MAX_STEPS);
+
+    return 0;
+}
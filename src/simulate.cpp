@@ -2,19 +2,585 @@
 // Created by Matthew Edwards on 2/26/18.
 //
 
-#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
 #include <string>
+#include <vector>
 
+#include "Batch.h"
+#include "GdbStub.h"
+#include "History.h"
+#include "Multiprocessor.h"
+#include "Sampler.h"
 #include "Simulator.h"
+#include "SymbolMap.h"
+#include "Verifier.h"
+
+struct Watch
+{
+    unsigned int address;
+    size_t size;
+    m20::Access access;
+};
+
+// Writes --last-write goes back through
+static const size_t MAX_WRITES = 8;
+
+/**
+ * Parses <addr>[,<len>][:r|w|rw]; numbers take a C prefix (0x...)
+ */
+static bool parseWatch(const std::string &spec, Watch &watch)
+{
+    const char *p = spec.c_str();
+    char *end = nullptr;
+    watch.address = (unsigned int) std::strtoul(p, &end, 0);
+    watch.size = 4;
+    watch.access = m20::Access::WRITE;
+    if (end == p)
+    {
+        return false;
+    }
+    if (*end == ',')
+    {
+        p = end + 1;
+        watch.size = std::strtoul(p, &end, 0);
+        if (end == p || watch.size == 0)
+        {
+            return false;
+        }
+    }
+    if (*end == ':')
+    {
+        std::string access(end + 1);
+        if (access == "r")
+        {
+            watch.access = m20::Access::READ;
+        }
+        else if (access == "w")
+        {
+            watch.access = m20::Access::WRITE;
+        }
+        else if (access == "rw")
+        {
+            watch.access = m20::Access::READ_WRITE;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+    return *end == '\0';
+}
+
+static void printUsage(const char *name)
+{
+    std::cerr << "Usage: " << name << " [options] <executable.mc>\n"
+              << "  --engine=<reference|predecoded|tiered>\n"
+              << "                                   Execution engine "
+                 "(default: predecoded)\n"
+              << "  --tier-thresholds=<p>,<t>        Block entries before "
+                 "the tiered engine\n"
+              << "                                   predecodes, then "
+                 "translates (default: 16,64)\n"
+              << "  --tier-report                    Print instructions per "
+                 "tier and promotions\n"
+              << "                                   after halting\n"
+              << "  --exceptions=<halt|vector>       Halt on aborts, or "
+                 "enter abort mode through\n"
+              << "                                   the vector table "
+                 "(default: halt)\n"
+              << "  --no-fusion                      Disable superinstruction "
+                 "fusion\n"
+              << "  --fusion-report                  Print fusion hit rates "
+                 "after halting\n"
+              << "  --histogram                      Print the instruction mix "
+                 "after halting\n"
+              << "  --profile[=<usec>]               Sample the guest PC every "
+                 "usec of CPU time\n"
+              << "                                   (default: 1000) and "
+                 "print a profile\n"
+              << "  --heatmap[=<file.csv>]           Print guest memory "
+                 "accesses per cache line\n"
+              << "                                   after halting "
+                 "(optionally also as CSV)\n"
+              << "  --callgraph[=<file>]             Print inclusive and "
+                 "exclusive instructions per\n"
+              << "                                   function (optionally "
+                 "also as callgrind)\n"
+              << "  --watch=<addr>[,<len>][:r|w|rw]  Stop on guest accesses "
+                 "to the range and\n"
+              << "                                   print them (default: 4 "
+                 "bytes, w)\n"
+              << "  --last-write=<addr>[,<len>]      After halting, go back "
+                 "through the writes to\n"
+              << "                                   the range (default: 4 "
+                 "bytes) and print them\n"
+              << "  --history=<n>[,<MiB>]            Checkpoint every n "
+                 "instructions within MiB\n"
+              << "                                   for --last-write "
+                 "(default: 100000, 64)\n"
+              << "  --gdb=<port|socket>              Serve gdb on a localhost "
+                 "port or unix socket\n"
+              << "                                   instead of running "
+                 "(only with engine options)\n"
+              << "  --cores=<n>                      Run n cores on shared "
+                 "memory, one host thread\n"
+              << "                                   each (up to 32; only "
+                 "with engine options)\n"
+              << "  --batch=<n>                      Run n instances in "
+                 "lockstep, instance i with\n"
+              << "                                   r0 = i (up to 256; only "
+                 "with engine options)\n"
+              << "  --dump-cfg                       Print the control-flow "
+                 "graph and exit\n"
+              << "  --verify-against=reference       Run the reference "
+                 "engine in lockstep and\n"
+              << "                                   report the first "
+                 "divergence\n"
+              << std::flush;
+}
 
 int main(int argc, char **argv)
 {
     using namespace m20;
-    assert(argc == 2);
+
+    std::string executable;
+    Engine engine = Engine::PREDECODED;
+    bool vectoring = false;
+    bool fusion = true;
+    bool fusionReport = false;
+    uint32_t predecodeThreshold = Simulator::PREDECODE_THRESHOLD;
+    uint32_t translateThreshold = Simulator::TRANSLATE_THRESHOLD;
+    bool tierReport = false;
+    bool histogram = false;
+    unsigned int profile = 0;
+    bool heatmap = false;
+    std::string heatmapCsv;
+    bool callGraph = false;
+    std::string callgrind;
+    bool dumpCfg = false;
+    bool verify = false;
+    std::vector<Watch> watches;
+    bool lastWrite = false;
+    Watch written = {};
+    size_t interval = History::DEFAULT_INTERVAL;
+    size_t budget = History::DEFAULT_BUDGET;
+    unsigned long cores = 1;
+    unsigned long batch = 0;
+    std::string gdb;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg == "--engine=reference")
+        {
+            engine = Engine::REFERENCE;
+        }
+        else if (arg == "--engine=predecoded")
+        {
+            engine = Engine::PREDECODED;
+        }
+        else if (arg == "--engine=tiered")
+        {
+            engine = Engine::TIERED;
+        }
+        else if (arg.compare(0, 18, "--tier-thresholds=") == 0
+                 && std::strtoul(arg.c_str() + 18, nullptr, 10) >= 1)
+        {
+            char *end = nullptr;
+            predecodeThreshold = (uint32_t) std::strtoul(arg.c_str() + 18,
+                                                         &end, 10);
+            if (*end != ',' || std::strtoul(end + 1, nullptr, 10) < 1)
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
+            translateThreshold = (uint32_t) std::strtoul(end + 1, nullptr,
+                                                         10);
+        }
+        else if (arg == "--tier-report")
+        {
+            tierReport = true;
+        }
+        else if (arg == "--exceptions=halt")
+        {
+            vectoring = false;
+        }
+        else if (arg == "--exceptions=vector")
+        {
+            vectoring = true;
+        }
+        else if (arg == "--no-fusion")
+        {
+            fusion = false;
+        }
+        else if (arg == "--fusion-report")
+        {
+            fusionReport = true;
+        }
+        else if (arg == "--histogram")
+        {
+            histogram = true;
+        }
+        else if (arg == "--profile")
+        {
+            profile = Sampler::DEFAULT_INTERVAL;
+        }
+        else if (arg.compare(0, 10, "--profile=") == 0
+                 && std::strtoul(arg.c_str() + 10, nullptr, 10) > 0)
+        {
+            profile = (unsigned int) std::strtoul(arg.c_str() + 10, nullptr,
+                                                  10);
+        }
+        else if (arg == "--heatmap")
+        {
+            heatmap = true;
+        }
+        else if (arg.compare(0, 10, "--heatmap=") == 0 && arg.size() > 10)
+        {
+            heatmap = true;
+            heatmapCsv = arg.substr(10);
+        }
+        else if (arg == "--callgraph")
+        {
+            callGraph = true;
+        }
+        else if (arg.compare(0, 12, "--callgraph=") == 0 && arg.size() > 12)
+        {
+            callGraph = true;
+            callgrind = arg.substr(12);
+        }
+        else if (arg.compare(0, 8, "--watch=") == 0)
+        {
+            Watch watch = {};
+            if (!parseWatch(arg.substr(8), watch))
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
+            watches.push_back(watch);
+        }
+        else if (arg.compare(0, 13, "--last-write=") == 0)
+        {
+            if (!parseWatch(arg.substr(13), written)
+                || written.access != Access::WRITE)
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
+            lastWrite = true;
+        }
+        else if (arg.compare(0, 10, "--history=") == 0
+                 && std::strtoul(arg.c_str() + 10, nullptr, 10) >= 1)
+        {
+            char *end = nullptr;
+            interval = std::strtoul(arg.c_str() + 10, &end, 10);
+            if (*end == ',')
+            {
+                budget = std::strtoul(end + 1, nullptr, 10) << 20;
+            }
+        }
+        else if (arg.compare(0, 8, "--cores=") == 0
+                 && std::strtoul(arg.c_str() + 8, nullptr, 10) >= 1
+                 && std::strtoul(arg.c_str() + 8, nullptr, 10)
+                    <= Simulator::MAX_CORES)
+        {
+            cores = std::strtoul(arg.c_str() + 8, nullptr, 10);
+        }
+        else if (arg.compare(0, 8, "--batch=") == 0
+                 && std::strtoul(arg.c_str() + 8, nullptr, 10) >= 1
+                 && std::strtoul(arg.c_str() + 8, nullptr, 10)
+                    <= Batch::MAX_LANES)
+        {
+            batch = std::strtoul(arg.c_str() + 8, nullptr, 10);
+        }
+        else if (arg.compare(0, 6, "--gdb=") == 0 && arg.size() > 6)
+        {
+            gdb = arg.substr(6);
+        }
+        else if (arg == "--dump-cfg")
+        {
+            dumpCfg = true;
+        }
+        else if (arg == "--verify-against=reference")
+        {
+            verify = true;
+        }
+        else if (arg.compare(0, 2, "--") != 0 && executable.empty())
+        {
+            executable = arg;
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (executable.empty() || (verify && !watches.empty())
+        || ((cores > 1 || batch > 0)
+            && (verify || !watches.empty() || histogram || heatmap
+                || callGraph || profile != 0 || lastWrite))
+        || (lastWrite
+            && (verify || !watches.empty() || histogram || heatmap
+                || callGraph))
+        || (cores > 1 && batch > 0)
+        || (!gdb.empty()
+            && (verify || !watches.empty() || histogram || heatmap
+                || callGraph || profile != 0 || lastWrite || cores > 1
+                || batch > 0)))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (batch > 0)
+    {
+        Batch lanes(65536, (unsigned int) batch);
+        for (unsigned int id = 0; id < lanes.getLaneCount(); ++id)
+        {
+            lanes.getLane(id).setEngine(engine);
+            lanes.getLane(id).setVectoring(vectoring);
+            lanes.getLane(id).setFusion(fusion);
+            lanes.getLane(id).setTierThresholds(predecodeThreshold,
+                                                translateThreshold);
+        }
+        if (!lanes.load(executable))
+        {
+            return 1;
+        }
+        if (dumpCfg)
+        {
+            lanes.getLane(0).getControlFlowGraph().print(std::cout);
+            return 0;
+        }
+
+        lanes.simulate();
+        return 0;
+    }
+
+    if (cores > 1)
+    {
+        Multiprocessor machine(65536, (unsigned int) cores);
+        for (unsigned int id = 0; id < machine.getCoreCount(); ++id)
+        {
+            machine.getCore(id).setEngine(engine);
+            machine.getCore(id).setVectoring(vectoring);
+            machine.getCore(id).setFusion(fusion);
+            machine.getCore(id).setTierThresholds(predecodeThreshold,
+                                                  translateThreshold);
+        }
+        if (!machine.load(executable))
+        {
+            return 1;
+        }
+        if (dumpCfg)
+        {
+            machine.getCore(0).getControlFlowGraph().print(std::cout);
+            return 0;
+        }
+
+        machine.simulate();
+        if (fusionReport)
+        {
+            machine.getCore(0).printFusionReport();
+        }
+        if (tierReport)
+        {
+            machine.getCore(0).printTierReport();
+        }
+        return 0;
+    }
 
     Simulator simulator(65536);
-    simulator.load(std::string(argv[1]));
-    simulator.simulate();
+    simulator.setEngine(engine);
+    simulator.setVectoring(vectoring);
+    simulator.setFusion(fusion);
+    simulator.setTierThresholds(predecodeThreshold, translateThreshold);
+    simulator.setHistogram(histogram);
+    simulator.setHeatmap(heatmap);
+    simulator.setCallGraph(callGraph);
+    if (!simulator.load(executable))
+    {
+        return 1;
+    }
+    if (heatmap)
+    {
+        SymbolMap symbols;
+        symbols.load(executable + ".sym");
+        auto imageEnd = (unsigned int) simulator.getImageSize();
+        simulator.getHeatmap().setLayout(symbols.getDataBegin(), imageEnd);
+    }
+    for (const auto &watch : watches)
+    {
+        if (!simulator.addWatchpoint(watch.address, watch.size, watch.access))
+        {
+            std::cerr << "Watchpoint outside of memory: 0x" << std::hex
+                      << watch.address << std::endl;
+            return 1;
+        }
+    }
+
+    if (dumpCfg)
+    {
+        simulator.getControlFlowGraph().print(std::cout);
+        return 0;
+    }
+
+    if (!gdb.empty())
+    {
+        GdbStub stub(simulator);
+        return stub.listen(gdb) && stub.serve() ? 0 : 1;
+    }
+
+    Sampler sampler(simulator);
+    if (profile != 0 && !sampler.start(profile))
+    {
+        std::cerr << "Cannot start the profiling timer" << std::endl;
+        return 1;
+    }
+
+    bool consistent = true;
+    if (verify)
+    {
+        std::ostream discard(nullptr);
+        Simulator reference(65536);
+        reference.setEngine(Engine::REFERENCE);
+        reference.setVectoring(vectoring);
+        reference.setOutput(discard);
+        if (!reference.load(executable))
+        {
+            return 1;
+        }
+
+        Status status;
+        Verifier verifier(simulator, reference, std::cerr);
+        consistent = verifier.verify(status);
+        simulator.report(status);
+    }
+    else if (lastWrite)
+    {
+        SymbolMap symbols;
+        symbols.load(executable + ".sym");
+
+        History history(simulator, interval, budget);
+        history.reset();
+        Status status = history.run(SIZE_MAX);
+        simulator.report(status);
+
+        // Each write found moves before it, so the next search finds the
+        // one that came before
+        WatchHit hit = {};
+        size_t found = 0;
+        while (found < MAX_WRITES
+               && history.runBackToWrite(written.address, written.size, hit))
+        {
+            std::cerr << ">>>>> Write of " << std::dec << hit.size
+                      << " @ 0x" << std::hex << hit.address << " by "
+                      << symbols.describe(hit.pc) << " at instruction "
+                      << std::dec << simulator.getInstructionsExecuted()
+                      << ": 0x" << std::hex << (unsigned int) hit.oldValue
+                      << " -> 0x" << (unsigned int) hit.newValue << std::dec
+                      << std::endl;
+            ++found;
+            if (!history.reverseStep())
+            {
+                break;
+            }
+        }
+        if (found == 0)
+        {
+            std::cerr << ">>>>> No write to 0x" << std::hex
+                      << written.address << std::dec << " since instruction "
+                      << history.getOldest() << std::endl;
+        }
+    }
+    else if (!watches.empty())
+    {
+        SymbolMap symbols;
+        symbols.load(executable + ".sym");
+
+        Status status;
+        simulator.reset();
+        while ((status = simulator.run(SIZE_MAX)) == Status::WATCHPOINT)
+        {
+            const WatchHit &hit = simulator.getWatchHit();
+            std::cerr << ">>>>> Watchpoint "
+                      << (hit.access == Access::READ ? "read" : "write")
+                      << " of " << std::dec << hit.size << " @ 0x" << std::hex
+                      << hit.address << " by " << symbols.describe(hit.pc)
+                      << ": 0x" << (unsigned int) hit.oldValue;
+            if (hit.access == Access::WRITE)
+            {
+                std::cerr << " -> 0x" << (unsigned int) hit.newValue;
+            }
+            std::cerr << std::dec << " after "
+                      << simulator.getInstructionsExecuted()
+                      << " instructions" << std::endl;
+        }
+        simulator.report(status);
+    }
+    else
+    {
+        simulator.simulate();
+    }
+
+    sampler.stop();
+
+    if (fusionReport)
+    {
+        simulator.printFusionReport();
+    }
+    if (tierReport)
+    {
+        simulator.printTierReport();
+    }
+    if (histogram)
+    {
+        simulator.printHistogram();
+    }
+    if (profile != 0)
+    {
+        SymbolMap symbols;
+        symbols.load(executable + ".sym");
+        sampler.print(std::cout, symbols);
+    }
+    if (heatmap)
+    {
+        simulator.getHeatmap().print(std::cout);
+        if (!heatmapCsv.empty())
+        {
+            std::ofstream csv(heatmapCsv);
+            simulator.getHeatmap().writeCsv(csv);
+            if (!csv)
+            {
+                std::cerr << "Cannot write " << heatmapCsv << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    if (callGraph)
+    {
+        SymbolMap symbols;
+        symbols.load(executable + ".sym");
+        simulator.getCallGraph().close();
+        simulator.getCallGraph().print(std::cout, symbols);
+        if (!callgrind.empty())
+        {
+            std::ofstream file(callgrind);
+            simulator.getCallGraph().writeCallgrind(file, symbols,
+                                                    executable);
+            if (!file)
+            {
+                std::cerr << "Cannot write " << callgrind << std::endl;
+                return 1;
+            }
+        }
+    }
 
-    return 0;
+    return consistent ? 0 : 2;
 }